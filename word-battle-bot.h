@@ -0,0 +1,97 @@
+// Bot interface for word-battle.
+//
+// A bot is a shared library (.so, .dylib or .dll), in C or C++, that exports
+// two plain C functions. WB_BOT_EXPORT supplies the extern "C" a C++ bot
+// needs:
+//
+//     #include "word-battle-bot.h"
+//
+//     WB_BOT_EXPORT int32_t wbAbiVersion(void) { return WB_BOT_ABI_VERSION; }
+//
+//     WB_BOT_EXPORT int32_t chooseMove(const WbGameState* state, WbMove* move)
+//     {
+//         ... fill *move from state->rack ...
+//         return 0;
+//     }
+//
+// Load it into a seat with --bot0/--bot1 PATH, or list it in --tournament.
+// The structs below are the whole contract. They only grow into their
+// reserved space, and WB_BOT_ABI_VERSION changes whenever an existing field
+// does, so a library built against an older header is refused rather than
+// misread.
+#ifndef WORD_BATTLE_BOT_H
+#define WORD_BATTLE_BOT_H
+
+#include <stdint.h>
+
+#define WB_BOT_ABI_VERSION 1
+
+#define WB_NUM_SPACES 7
+#define WB_MAX_RACK 16
+#define WB_TILE_KINDS 27   // 'A'..'Z', then the blank
+
+// Multipliers a move may put under each of its letters.
+enum {
+    WB_MULT_NONE = 0,
+    WB_MULT_DOUBLE_LETTER = 1,
+    WB_MULT_TRIPLE_LETTER = 2,
+    WB_MULT_DOUBLE_WORD = 3,
+    WB_MULT_TRIPLE_WORD = 4
+};
+
+// What the seat to move can see.
+typedef struct WbGameState {
+    uint32_t abiVersion;              // WB_BOT_ABI_VERSION of the host
+    int32_t seat;                     // 0 or 1
+    int32_t movesDone;                // moves played so far by both seats
+    int32_t maxMoves;                 // the game ends when movesDone gets here
+    int32_t scores[2];
+    int32_t bagSize;
+    int32_t timeLimitMs;              // per move, 0 for none
+    char rack[WB_MAX_RACK];           // NUL-terminated, 'A'..'Z' and '?' for a blank
+    int32_t unseen[WB_TILE_KINDS];    // tiles in the bag plus the opponent's rack
+    int32_t letterScores[26];
+    uint32_t seed;                    // fresh every move, for any randomness
+    int32_t reserved[16];
+} WbGameState;
+
+// The letters laid left to right into spaces 0..n-1. An empty word passes,
+// and so does an illegal move: a tile not on the rack, a word not in the
+// dictionary or more than WB_NUM_SPACES letters.
+typedef struct WbMove {
+    char word[WB_NUM_SPACES + 1];     // NUL-terminated 'A'..'Z'
+    uint32_t blanks;                  // bit i set: word[i] is played with a blank
+    int32_t mults[WB_NUM_SPACES];     // WB_MULT_* under each letter
+    int32_t reserved[8];
+} WbMove;
+
+// Exports a function under its plain C name, also from C++, where the
+// host's lookup would otherwise miss the mangled one.
+#ifdef __cplusplus
+#define WB_BOT_EXTERN_C extern "C"
+#else
+#define WB_BOT_EXTERN_C
+#endif
+
+#ifdef _WIN32
+#define WB_BOT_EXPORT WB_BOT_EXTERN_C __declspec(dllexport)
+#else
+#define WB_BOT_EXPORT WB_BOT_EXTERN_C __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// wbAbiVersion: the WB_BOT_ABI_VERSION the bot was built with.
+typedef int32_t (*WbAbiVersionFn)(void);
+
+// chooseMove: fills *move (zeroed by the host) for *state. Returns 0 on
+// success; anything else counts as a pass.
+typedef int32_t (*WbChooseMoveFn)(const WbGameState* state, WbMove* move);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
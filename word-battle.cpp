@@ -10,6 +10,56 @@
 #include <algorithm>
 #include <random>
 #include <cctype>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <bitset>
+#include <deque>
+#include <cerrno>
+#include <filesystem>
+#include <memory>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "word-battle-bot.h"
+
+const int NUM_SPACES = 7;
+const int RACK_SIZE = 7;
+const int MAX_MOVES = 20;
+
+std::string dictionaryPath = "C:/Users/saadc/words_alpha.txt";
 
 float clampFloat(float v, float lo, float hi)
 {
@@ -79,13 +129,15 @@ struct Button {
     }
 };
 
+// A rack tile as the game logic sees it: letter, score and where it sits.
+// Drawing goes through TileSprite on the render thread, which is the only
+// thread that touches fonts.
 struct Tile {
     char letter;
     int  score;
+    char blankAs;        // letter a blank on the row stands for, 0 until named
 
     sf::RectangleShape rect;
-    sf::Text letterText;
-    sf::Text scoreText;
 
     bool grabbed;
     sf::Vector2f grabOffset;
@@ -93,16 +145,60 @@ struct Tile {
     int occupantSpace;   
     sf::Vector2f revertPosition;
 
-    Tile(char c, int s, const sf::Font& font, float size = 64.f)
+    Tile(char c, int s, float size = 64.f)
         : letter(c)
         , score(s)
+        , blankAs(0)
         , rect({ size, size })
-        , letterText(font, std::string(1, c), static_cast<unsigned int>(size * 0.6f))
-        , scoreText(font, std::to_string(s), static_cast<unsigned int>(size * 0.24f))
         , grabbed(false)
         , grabOffset(0.f, 0.f)
         , occupantSpace(-1)
         , revertPosition(0.f, 0.f)
+    {
+    }
+
+    void setPosition(const sf::Vector2f& pos) {
+        rect.setPosition(pos);
+    }
+
+    sf::Vector2f getPosition() const {
+        return rect.getPosition();
+    }
+
+    sf::Vector2f getSize() const {
+        return rect.getSize();
+    }
+
+    sf::Vector2f getCenter() const {
+        return getPosition() + getSize() / 2.f;
+    }
+
+    bool contains(sf::Vector2f p) const {
+        sf::Vector2f pos = rect.getPosition();
+        sf::Vector2f s = rect.getSize();
+        return (p.x >= pos.x && p.x <= pos.x + s.x &&
+            p.y >= pos.y && p.y <= pos.y + s.y);
+    }
+};
+
+// What the render thread needs to draw one tile.
+struct TileState {
+    sf::Vector2f position;
+    char letter;
+    int score;
+};
+
+struct TileSprite {
+    sf::RectangleShape rect;
+    sf::Text letterText;
+    sf::Text scoreText;
+    TileState shown;
+
+    TileSprite(const sf::Font& font, float size = 64.f)
+        : rect({ size, size })
+        , letterText(font, "", static_cast<unsigned int>(size * 0.6f))
+        , scoreText(font, "", static_cast<unsigned int>(size * 0.24f))
+        , shown{ sf::Vector2f(0.f, 0.f), 0, -1 }
     {
         rect.setFillColor(sf::Color(245, 240, 210));
         rect.setOutlineColor(sf::Color(80, 80, 80));
@@ -114,8 +210,17 @@ struct Tile {
         scoreText.setFillColor(sf::Color::Black);
     }
 
-    void setPosition(const sf::Vector2f& pos) {
-        rect.setPosition(pos);
+    // Text layout is only redone when the tile actually changed.
+    void show(const TileState& t) {
+        bool relabel = t.letter != shown.letter || t.score != shown.score;
+        if (relabel) {
+            letterText.setString(std::string(1, t.letter));
+            scoreText.setString(std::to_string(t.score));
+        }
+        if (!relabel && t.position == shown.position) return;
+        shown = t;
+
+        rect.setPosition(t.position);
 
         sf::Vector2f sz = rect.getSize();
 
@@ -125,7 +230,7 @@ struct Tile {
             lb.position.y + lb.size.y / 2.f
         );
         letterText.setOrigin(originLetter);
-        letterText.setPosition(pos + sf::Vector2f(sz.x / 2.f, sz.y / 2.3f));
+        letterText.setPosition(t.position + sf::Vector2f(sz.x / 2.f, sz.y / 2.3f));
 
         sf::FloatRect sb = scoreText.getLocalBounds();
         sf::Vector2f originScore(
@@ -133,26 +238,7 @@ struct Tile {
             sb.position.y + sb.size.y
         );
         scoreText.setOrigin(originScore);
-        scoreText.setPosition(pos + sf::Vector2f(sz.x - 6.f, sz.y - 6.f));
-    }
-
-    sf::Vector2f getPosition() const {
-        return rect.getPosition();
-    }
-
-    sf::Vector2f getSize() const {
-        return rect.getSize();
-    }
-
-    sf::Vector2f getCenter() const {
-        return getPosition() + getSize() / 2.f;
-    }
-
-    bool contains(sf::Vector2f p) const {
-        sf::Vector2f pos = rect.getPosition();
-        sf::Vector2f s = rect.getSize();
-        return (p.x >= pos.x && p.x <= pos.x + s.x &&
-            p.y >= pos.y && p.y <= pos.y + s.y);
+        scoreText.setPosition(t.position + sf::Vector2f(sz.x - 6.f, sz.y - 6.f));
     }
 
     void draw(sf::RenderWindow& win) const {
@@ -252,6 +338,36 @@ void pushMany(std::vector<char>& bag, char c, int count) {
     }
 }
 
+void fillStandardBag(std::vector<char>& bag) {
+    pushMany(bag, 'E', 12);
+    pushMany(bag, 'A', 9);
+    pushMany(bag, 'I', 9);
+    pushMany(bag, 'O', 8);
+    pushMany(bag, 'N', 6);
+    pushMany(bag, 'R', 6);
+    pushMany(bag, 'T', 6);
+    pushMany(bag, 'L', 4);
+    pushMany(bag, 'S', 4);
+    pushMany(bag, 'U', 4);
+    pushMany(bag, 'D', 4);
+    pushMany(bag, 'G', 3);
+    pushMany(bag, 'B', 2);
+    pushMany(bag, 'C', 2);
+    pushMany(bag, 'M', 2);
+    pushMany(bag, 'P', 2);
+    pushMany(bag, 'F', 2);
+    pushMany(bag, 'H', 2);
+    pushMany(bag, 'V', 2);
+    pushMany(bag, 'W', 2);
+    pushMany(bag, 'Y', 2);
+    pushMany(bag, 'K', 1);
+    pushMany(bag, 'J', 1);
+    pushMany(bag, 'X', 1);
+    pushMany(bag, 'Q', 1);
+    pushMany(bag, 'Z', 1);
+    pushMany(bag, '?', 2);
+}
+
 void reflowRack(
     std::vector<Tile>& tiles,
     float regionStartX,
@@ -280,20 +396,16 @@ void reflowRack(
     }
 }
 
-bool isValidWord(const std::string& word)
+const std::unordered_set<std::string>& dictionaryWords()
 {
-    static std::unordered_set<std::string> words;
-    static bool loaded = false;
-
-    if (!loaded)
-    {
-        std::ifstream file("C:/Users/saadc/words_alpha.txt"); 
+    static const std::unordered_set<std::string> words = [] {
+        std::unordered_set<std::string> loaded;
+        std::ifstream file(dictionaryPath);
         if (!file.is_open())
         {
             std::cerr << "[WARN] Could not open dictionary file. "
                 "Treating all words as valid.\n";
-            loaded = true;
-            return true;
+            return loaded;
         }
 
         std::string w;
@@ -303,35 +415,3998 @@ bool isValidWord(const std::string& word)
                 w.begin(), w.end(), w.begin(),
                 [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); }
             );
-            words.insert(w);
+            loaded.insert(w);
+        }
+        return loaded;
+    }();
+    return words;
+}
+
+bool isValidWord(const std::string& word)
+{
+    const std::unordered_set<std::string>& words = dictionaryWords();
+
+    std::string check = word;
+    std::transform(
+        check.begin(), check.end(), check.begin(),
+        [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); }
+    );
+
+    if (words.empty())
+    {
+        return true;
+    }
+
+    if (words.find(check) != words.end())
+    {
+        std::cout << "Valid English word: " << check << "\n";
+        return true;
+    }
+    else
+    {
+        std::cout << "Not found in dictionary: " << check << "\n";
+        return false;
+    }
+}
+
+int letterScore(char c)
+{
+    static const int scores[26] = {
+        1, 3, 3, 2, 1, 4, 2, 4, 1, 8, 5, 1, 3,
+        1, 1, 3, 10, 1, 1, 1, 1, 4, 4, 8, 4, 10
+    };
+    char up = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    if (up < 'A' || up > 'Z') return 0;
+    return scores[up - 'A'];
+}
+
+// Letters A-Z, then the blank, which is written '?' and scores nothing.
+const int TILE_KINDS = 27;
+const int BLANK_KIND = 26;
+const char BLANK = '?';
+
+int tileIndex(char c)
+{
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c == BLANK) return BLANK_KIND;
+    return -1;
+}
+
+char tileChar(int kind)
+{
+    return kind == BLANK_KIND ? BLANK : static_cast<char>('A' + kind);
+}
+
+double binomial(int n, int k)
+{
+    if (k < 0 || k > n) return 0.0;
+    if (k > n - k) k = n - k;
+    double r = 1.0;
+    for (int i = 1; i <= k; ++i) {
+        r = r * static_cast<double>(n - k + i) / static_cast<double>(i);
+    }
+    return r;
+}
+
+// Tiles as per-letter counts, with a Fenwick tree over the counts so a
+// uniformly random tile can be drawn in a handful of steps regardless of how
+// many tiles are left. Drawing this way one tile at a time gives exactly the
+// distribution of popping a uniformly shuffled bag.
+struct LetterPool {
+    int counts[TILE_KINDS];
+    int tree[TILE_KINDS + 1];
+    int total;
+
+    LetterPool()
+        : total(0)
+    {
+        std::fill(counts, counts + TILE_KINDS, 0);
+        std::fill(tree, tree + TILE_KINDS + 1, 0);
+    }
+
+    void adjust(int kind, int delta) {
+        counts[kind] += delta;
+        total += delta;
+        for (int i = kind + 1; i <= TILE_KINDS; i += i & (-i)) tree[i] += delta;
+    }
+
+    void add(char c, int n = 1) {
+        int kind = tileIndex(c);
+        if (kind >= 0) adjust(kind, n);
+    }
+
+    bool remove(char c) {
+        int kind = tileIndex(c);
+        if (kind < 0 || counts[kind] == 0) return false;
+        adjust(kind, -1);
+        return true;
+    }
+
+    int count(char c) const {
+        int kind = tileIndex(c);
+        return kind < 0 ? 0 : counts[kind];
+    }
+
+    int size() const {
+        return total;
+    }
+
+    bool empty() const {
+        return total == 0;
+    }
+
+    // Letter of the r-th remaining tile (0-based) in alphabetical order.
+    char tileAt(int r) const {
+        int pos = 0;
+        for (int step = 32; step > 0; step >>= 1) {
+            int next = pos + step;
+            if (next <= TILE_KINDS && tree[next] <= r) {
+                pos = next;
+                r -= tree[next];
+            }
+        }
+        return tileChar(pos);
+    }
+
+    char draw(std::mt19937& rng) {
+        std::uniform_int_distribution<int> pick(0, total - 1);
+        char c = tileAt(pick(rng));
+        remove(c);
+        return c;
+    }
+
+    // Exact chance that the next tile drawn is `c`.
+    double probNext(char c) const {
+        return total > 0 ? static_cast<double>(count(c)) / total : 0.0;
+    }
+
+    // Exact (hypergeometric) chance of at least `atLeast` copies of `c`
+    // among `draws` tiles drawn without replacement.
+    double probAtLeast(char c, int atLeast, int draws) const {
+        draws = std::min(draws, total);
+        if (atLeast <= 0) return 1.0;
+        const int k = count(c);
+        const double all = binomial(total, draws);
+        if (all <= 0.0) return 0.0;
+
+        double p = 0.0;
+        for (int x = atLeast; x <= std::min(k, draws); ++x) {
+            p += binomial(k, x) * binomial(total - k, draws - x);
+        }
+        return p / all;
+    }
+
+    // Expected face value of `draws` tiles drawn without replacement.
+    double expectedDrawScore(int draws) const {
+        if (total == 0) return 0.0;
+        draws = std::min(draws, total);
+        double sum = 0.0;
+        for (int kind = 0; kind < TILE_KINDS; ++kind) {
+            sum += static_cast<double>(counts[kind]) * letterScore(tileChar(kind));
+        }
+        return sum * draws / total;
+    }
+};
+
+// The game's bag: the tiles in the order they will be drawn plus a LetterPool
+// kept in step with them. It is filled and shuffled exactly as the plain
+// std::vector<char> bag was, so a given seed still deals the same tiles.
+struct TileBag {
+    std::vector<char> order;   // drawn from the back
+    LetterPool pool;
+
+    TileBag() = default;
+
+    explicit TileBag(unsigned seed) {
+        fillStandardBag(order);
+        std::mt19937 rng(seed);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (char c : order) pool.add(c);
+    }
+
+    bool empty() const {
+        return order.empty();
+    }
+
+    std::size_t size() const {
+        return order.size();
+    }
+
+    char draw() {
+        char c = order.back();
+        order.pop_back();
+        pool.remove(c);
+        return c;
+    }
+
+    // Puts a drawn tile back on top, so the next draw() returns it again.
+    void putBack(char c) {
+        order.push_back(c);
+        pool.add(c);
+    }
+};
+
+const int LEAVE_MAX_TILES = 6;
+
+// Ranks a sorted multiset of tile kinds among all multisets of its size
+// (combinatorial number system over kind + position), with each size from 0
+// to LEAVE_MAX_TILES given its own contiguous block of indices. With 27 tile
+// kinds that is C(33, 6) = 1,107,568 entries, 914,625 of them leaves the
+// standard bag can actually supply.
+struct LeaveIndexer {
+    std::uint32_t choose[TILE_KINDS + LEAVE_MAX_TILES + 1][LEAVE_MAX_TILES + 1];
+    std::uint32_t offset[LEAVE_MAX_TILES + 2];
+
+    LeaveIndexer() {
+        for (int n = 0; n <= TILE_KINDS + LEAVE_MAX_TILES; ++n) {
+            for (int k = 0; k <= LEAVE_MAX_TILES; ++k) {
+                choose[n][k] = static_cast<std::uint32_t>(binomial(n, k));
+            }
+        }
+        offset[0] = 0;
+        for (int n = 0; n <= LEAVE_MAX_TILES; ++n) {
+            offset[n + 1] = offset[n] + choose[TILE_KINDS + n - 1][n];
+        }
+    }
+
+    std::uint32_t entries() const {
+        return offset[LEAVE_MAX_TILES + 1];
+    }
+
+    std::uint32_t index(const int* sortedKinds, int n) const {
+        std::uint32_t r = offset[n];
+        for (int i = 0; i < n; ++i) r += choose[sortedKinds[i] + i][i + 1];
+        return r;
+    }
+
+    // Same as index() for kinds padded to LEAVE_MAX_TILES entries, without a
+    // loop whose length depends on n.
+    std::uint32_t indexPadded(const int* sortedKinds, int n) const {
+        std::uint32_t r = offset[n];
+        for (int i = 0; i < LEAVE_MAX_TILES; ++i) {
+            r += (i < n) ? choose[sortedKinds[i] + i][i + 1] : 0u;
+        }
+        return r;
+    }
+};
+
+const LeaveIndexer& leaveIndexer()
+{
+    static const LeaveIndexer indexer;
+    return indexer;
+}
+
+inline void compareExchange(int& a, int& b)
+{
+    int lo = std::min(a, b);
+    b = std::max(a, b);
+    a = lo;
+}
+
+struct LeaveTableHeader {
+    char magic[4];            // "WBLV"
+    std::uint32_t version;
+    std::uint32_t kinds;      // TILE_KINDS the table was built for
+    std::uint32_t maxTiles;   // LEAVE_MAX_TILES the table was built for
+    std::uint32_t entries;
+    std::uint32_t samples;    // simulated turns per leave
+    float baseline;           // mean next-turn score from an empty leave
+    std::uint32_t reserved;
+};
+
+const std::uint32_t LEAVE_TABLE_VERSION = 1;
+
+// Leave values written by --build-leaves, mapped read-only straight from
+// disk. Opening parses nothing, and a lookup is a 12-comparator sorting
+// network over six padded letters plus one array read.
+struct LeaveTable {
+    const void* base;
+    std::size_t mappedSize;
+    const LeaveTableHeader* header;
+    const float* values;
+    const LeaveIndexer* indexer;
+
+    LeaveTable()
+        : base(nullptr)
+        , mappedSize(0)
+        , header(nullptr)
+        , values(nullptr)
+        , indexer(&leaveIndexer())
+    {
+    }
+
+    ~LeaveTable() {
+        close();
+    }
+
+    LeaveTable(const LeaveTable&) = delete;
+    LeaveTable& operator=(const LeaveTable&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(LeaveTableHeader))) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (map == nullptr) return false;
+        void* p = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(map);
+        if (p == nullptr) return false;
+        mappedSize = static_cast<std::size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(LeaveTableHeader))) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        mappedSize = static_cast<std::size_t>(st.st_size);
+#endif
+        base = p;
+        header = static_cast<const LeaveTableHeader*>(base);
+
+        const std::size_t expected =
+            sizeof(LeaveTableHeader) + static_cast<std::size_t>(indexer->entries()) * sizeof(float);
+        if (std::memcmp(header->magic, "WBLV", 4) != 0 ||
+            header->version != LEAVE_TABLE_VERSION ||
+            header->kinds != static_cast<std::uint32_t>(TILE_KINDS) ||
+            header->maxTiles != static_cast<std::uint32_t>(LEAVE_MAX_TILES) ||
+            header->entries != indexer->entries() ||
+            mappedSize != expected)
+        {
+            std::cerr << "[WARN] Leave table " << path << " does not match this build; ignoring it.\n";
+            close();
+            return false;
+        }
+        values = reinterpret_cast<const float*>(header + 1);
+        return true;
+    }
+
+    void close() {
+        if (base != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+#else
+            munmap(const_cast<void*>(base), mappedSize);
+#endif
+        }
+        base = nullptr;
+        mappedSize = 0;
+        header = nullptr;
+        values = nullptr;
+    }
+
+    bool loaded() const {
+        return values != nullptr;
+    }
+
+    // Value of keeping `leave` on the rack; 0 when no table is loaded.
+    float value(const char* leave, int n) const {
+        if (values == nullptr || n > LEAVE_MAX_TILES) return 0.f;
+
+        // Unused slots sort last. A fixed compare-exchange network keeps the
+        // sort free of data-dependent branches.
+        int k[LEAVE_MAX_TILES];
+        for (int i = 0; i < LEAVE_MAX_TILES; ++i) {
+            k[i] = (i < n) ? tileIndex(leave[i]) : TILE_KINDS;
+            if (k[i] < 0) return 0.f;
+        }
+        compareExchange(k[0], k[5]); compareExchange(k[1], k[3]); compareExchange(k[2], k[4]);
+        compareExchange(k[1], k[2]); compareExchange(k[3], k[4]);
+        compareExchange(k[0], k[3]); compareExchange(k[2], k[5]);
+        compareExchange(k[0], k[1]); compareExchange(k[2], k[3]); compareExchange(k[4], k[5]);
+        compareExchange(k[1], k[2]); compareExchange(k[3], k[4]);
+        return values[indexer->indexPadded(k, n)];
+    }
+
+    float value(const std::string& leave) const {
+        return value(leave.data(), static_cast<int>(leave.size()));
+    }
+};
+
+int scorePlacement(const int* letterScores, const Mult* mults, int count)
+{
+    int letterSum = 0;
+    int wordMult = 1;
+
+    for (int i = 0; i < count; ++i) {
+        int base = letterScores[i];
+        switch (mults[i]) {
+        case Mult::DOUBLE_LETTER: base *= 2; break;
+        case Mult::TRIPLE_LETTER: base *= 3; break;
+        case Mult::DOUBLE_WORD:   wordMult *= 2; break;
+        case Mult::TRIPLE_WORD:   wordMult *= 3; break;
+        default: break;
+        }
+        letterSum += base;
+    }
+    return letterSum * wordMult;
+}
+
+// A word played from the rack onto the row, left to right. Any tile may take
+// any multiplier, and sum * 3^n is never beaten by trading one triple word for
+// a letter bonus, so the engine always asks for triple word on every tile.
+struct Move {
+    std::string word;
+    unsigned blanks;   // bit i set when word[i] is played with a blank
+    Mult mults[NUM_SPACES];
+    int score;
+    float leave;       // LeaveTable value of what stays on the rack
+
+    // The word with blank-played letters in lower case, for display.
+    std::string label() const {
+        std::string t = word;
+        for (std::size_t i = 0; i < t.size() && i < 32; ++i) {
+            if (blanks & (1u << i)) t[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(t[i])));
+        }
+        return t;
+    }
+
+    // The rack tiles the move uses: its letters, with '?' for blanks.
+    std::string tiles() const {
+        std::string t = word;
+        for (std::size_t i = 0; i < t.size() && i < 32; ++i) {
+            if (blanks & (1u << i)) t[i] = BLANK;
+        }
+        return t;
+    }
+};
+
+// Lays `word` out as a move, multipliers chosen but not yet scored, and
+// fills letterScores[0..count) for scorePlacement or a ScoreBatch.
+Move layOutMove(const std::string& word, unsigned blanks, int* letterScores)
+{
+    Move m;
+    m.word = word;
+    m.blanks = blanks;
+    m.score = 0;
+    m.leave = 0.f;
+
+    int count = std::min(static_cast<int>(word.size()), NUM_SPACES);
+    for (int i = 0; i < NUM_SPACES; ++i) {
+        m.mults[i] = (i < count) ? Mult::TRIPLE_WORD : Mult::NONE;
+        if (i < count) letterScores[i] = (blanks & (1u << i)) ? 0 : letterScore(word[i]);
+    }
+    return m;
+}
+
+Move makeMove(const std::string& word, unsigned blanks = 0)
+{
+    int letterScores[NUM_SPACES];
+    Move m = layOutMove(word, blanks, letterScores);
+    m.score = scorePlacement(letterScores, m.mults, std::min(static_cast<int>(word.size()), NUM_SPACES));
+    return m;
+}
+
+// Bump allocator for one turn's scratch buffers. reset() hands everything
+// back for the next turn but keeps the memory, so a search that scores the
+// same number of candidates every turn stops allocating after the first.
+struct ScoreArena {
+    static const std::size_t ALIGN = 64;
+
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    std::vector<std::size_t> sizes;
+    std::size_t chunk = 0;
+    std::size_t used = 0;
+
+    void reset() {
+        // Fold several chunks into one big enough for all of them.
+        if (chunks.size() > 1) {
+            std::size_t total = 0;
+            for (std::size_t s : sizes) total += s;
+            chunks.clear();
+            sizes.clear();
+            chunks.emplace_back(new unsigned char[total + ALIGN]);
+            sizes.push_back(total);
+        }
+        chunk = 0;
+        used = 0;
+    }
+
+    template <typename T>
+    T* allocate(std::size_t n) {
+        std::size_t bytes = (n * sizeof(T) + ALIGN - 1) / ALIGN * ALIGN;
+        if (chunk >= chunks.size() || used + bytes > sizes[chunk]) {
+            if (chunk < chunks.size()) ++chunk;
+            if (chunk >= chunks.size()) {
+                std::size_t size = std::max<std::size_t>(bytes, std::size_t(1) << 20);
+                chunks.emplace_back(new unsigned char[size + ALIGN]);
+                sizes.push_back(size);
+            }
+            used = 0;
+        }
+        unsigned char* base = chunks[chunk].get();
+        base += (ALIGN - reinterpret_cast<std::uintptr_t>(base) % ALIGN) % ALIGN;
+        T* p = reinterpret_cast<T*>(base + used);
+        used += bytes;
+        return p;
+    }
+};
+
+// Candidate placements in structure-of-arrays form for scoreBatch(): for
+// every space i, one lane per candidate of letter score, letter multiplier
+// (1-3) and word multiplier (1-3). Spaces a candidate leaves empty hold 0,
+// 1 and 1, which add nothing. Lanes are padded to a multiple of 8 so the
+// vector loops never need a tail.
+struct ScoreBatch {
+    static const int LANES = 8;
+
+    int count = 0;
+    int capacity = 0;
+    std::int32_t* letter[NUM_SPACES];
+    std::int32_t* letterMult[NUM_SPACES];
+    std::int32_t* wordMult[NUM_SPACES];
+    std::int32_t* scores = nullptr;
+
+    ScoreBatch(ScoreArena& arena, int n) {
+        capacity = (std::max(n, 1) + LANES - 1) / LANES * LANES;
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            letter[i] = arena.allocate<std::int32_t>(capacity);
+            letterMult[i] = arena.allocate<std::int32_t>(capacity);
+            wordMult[i] = arena.allocate<std::int32_t>(capacity);
+        }
+        scores = arena.allocate<std::int32_t>(capacity);
+    }
+
+    // Same arguments as scorePlacement; returns the candidate's index.
+    int add(const int* letterScores, const Mult* mults, int n) {
+        const int c = count++;
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            int lm = 1, wm = 1;
+            if (i < n) {
+                if (mults[i] == Mult::DOUBLE_LETTER) lm = 2;
+                else if (mults[i] == Mult::TRIPLE_LETTER) lm = 3;
+                else if (mults[i] == Mult::DOUBLE_WORD) wm = 2;
+                else if (mults[i] == Mult::TRIPLE_WORD) wm = 3;
+            }
+            letter[i][c] = i < n ? letterScores[i] : 0;
+            letterMult[i][c] = lm;
+            wordMult[i][c] = wm;
+        }
+        return c;
+    }
+};
+
+// Scores every candidate in `b` into b.scores, bit for bit what
+// scorePlacement returns. Multipliers are only ever 1, 2 or 3, so x * m is
+// x + (x where m > 1) + (x where m > 2): compares, masks and adds, with no
+// vector multiply (SSE2 has none for 32-bit lanes). Word multipliers are
+// applied to the finished letter sum one space at a time, which gives the
+// same product as multiplying them together first.
+void scoreBatch(ScoreBatch& b)
+{
+    for (int c = b.count; c < b.capacity; ++c) {
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            b.letter[i][c] = 0;
+            b.letterMult[i][c] = 1;
+            b.wordMult[i][c] = 1;
+        }
+    }
+
+    int c = 0;
+#if defined(__AVX2__)
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    for (; c < b.count; c += 8) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.letter[i] + c));
+            __m256i m = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.letterMult[i] + c));
+            x = _mm256_add_epi32(
+                _mm256_add_epi32(x, _mm256_and_si256(x, _mm256_cmpgt_epi32(m, one))),
+                _mm256_and_si256(x, _mm256_cmpgt_epi32(m, two)));
+            sum = _mm256_add_epi32(sum, x);
+        }
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            __m256i m = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.wordMult[i] + c));
+            sum = _mm256_add_epi32(
+                _mm256_add_epi32(sum, _mm256_and_si256(sum, _mm256_cmpgt_epi32(m, one))),
+                _mm256_and_si256(sum, _mm256_cmpgt_epi32(m, two)));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b.scores + c), sum);
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    for (; c < b.count; c += 4) {
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(b.letter[i] + c));
+            __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(b.letterMult[i] + c));
+            x = _mm_add_epi32(
+                _mm_add_epi32(x, _mm_and_si128(x, _mm_cmpgt_epi32(m, one))),
+                _mm_and_si128(x, _mm_cmpgt_epi32(m, two)));
+            sum = _mm_add_epi32(sum, x);
+        }
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(b.wordMult[i] + c));
+            sum = _mm_add_epi32(
+                _mm_add_epi32(sum, _mm_and_si128(sum, _mm_cmpgt_epi32(m, one))),
+                _mm_and_si128(sum, _mm_cmpgt_epi32(m, two)));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(b.scores + c), sum);
+    }
+#endif
+    for (; c < b.count; ++c) {
+        std::int32_t sum = 0;
+        std::int32_t wm = 1;
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            sum += b.letter[i][c] * b.letterMult[i][c];
+            wm *= b.wordMult[i][c];
+        }
+        b.scores[c] = sum * wm;
+    }
+}
+
+// Scratch arena for the candidates of the turn being searched, one per
+// thread so rollout workers never share one.
+ScoreArena& turnArena()
+{
+    thread_local ScoreArena arena;
+    return arena;
+}
+
+// Dictionary words that fit on the row, upper-cased and keyed by their sorted
+// letters, so every playable word for a rack is one lookup per letter subset.
+const std::unordered_map<std::string, std::vector<std::string>>& anagramIndex()
+{
+    static const std::unordered_map<std::string, std::vector<std::string>> index = [] {
+        std::unordered_map<std::string, std::vector<std::string>> idx;
+        for (const std::string& w : dictionaryWords()) {
+            if (w.empty() || w.size() > static_cast<std::size_t>(NUM_SPACES)) continue;
+
+            std::string up;
+            bool alpha = true;
+            for (char ch : w) {
+                if (ch < 'a' || ch > 'z') { alpha = false; break; }
+                up += static_cast<char>(ch - 'a' + 'A');
+            }
+            if (!alpha) continue;
+
+            std::string key = up;
+            std::sort(key.begin(), key.end());
+            idx[key].push_back(up);
+        }
+        for (auto& kv : idx) std::sort(kv.second.begin(), kv.second.end());
+        return idx;
+    }();
+    return index;
+}
+
+// One answer to a pattern query: the word, which of its positions are played
+// with blank tiles, and the letters those blanks stand for, left to right.
+struct PatternMatch {
+    std::string word;
+    unsigned blankMask;
+    std::string blankLetters;
+};
+
+inline int popCount(std::uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(x);
+#else
+    return static_cast<int>(std::bitset<32>(x).count());
+#endif
+}
+
+// Index of the lowest set bit; x must not be zero.
+inline int lowestBit(std::uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return static_cast<int>(i);
+#else
+    return popCount((x & (0u - x)) - 1);
+#endif
+}
+
+// The dictionary as a compact trie plus per-length buckets of words packed
+// into fixed-width slots, for wildcard queries. In a pattern '?' stands for
+// exactly one letter and '*' for any run of letters, including none.
+//
+// Each bucket also keeps a 26-bit mask per word of the letters it uses, and
+// its counts of words and letters. A word can only be spelled from letters
+// it has, so most of a bucket is turned down by one AND on the mask.
+//
+// Without a rack every wildcard is filled freely and reported as a blank.
+// With a rack, wildcards must be filled from its tiles: a matching letter
+// tile when there is one, otherwise a blank ('?'), which is reported. Fixed
+// letters in the pattern are already on the row and cost no tiles.
+struct Lexicon {
+    struct Node {
+        std::uint32_t firstChild;   // child for the lowest letter in childMask
+        std::uint32_t childMask;    // bit c set when letter 'A' + c continues
+        std::uint32_t lengths;      // bit k set when a word ends k letters below
+    };
+
+    static const int MAX_WORD = 31;
+    static const int LONG_PATTERN = 8;   // fixed-length patterns this long scan buckets
+
+    // Built word by word as the buckets fill.
+    struct BucketStats {
+        std::size_t words = 0;
+        std::size_t containing[26] = {};   // words using the letter at least once
+        std::size_t letters[26] = {};      // times the letter is used in all
+
+        void add(const std::string& w) {
+            ++words;
+            std::uint32_t seen = 0;
+            for (char c : w) {
+                ++letters[c - 'A'];
+                seen |= 1u << (c - 'A');
+            }
+            for (; seen != 0; seen &= seen - 1) ++containing[lowestBit(seen)];
+        }
+    };
+
+    std::vector<Node> nodes;                     // nodes[0] is the root
+    std::vector<std::vector<char>> buckets;      // buckets[len]: packed, zero-padded words
+    std::vector<std::vector<std::uint32_t>> masks;   // masks[len][i]: letters of word i
+    std::vector<BucketStats> stats;              // stats[len]
+    std::size_t wordCount = 0;
+
+    static int bucketWidth(int len) {
+        return len <= 16 ? 16 : 32;
+    }
+
+    static std::uint32_t letterMask(const char* w, int len) {
+        std::uint32_t m = 0;
+        for (int i = 0; i < len; ++i) m |= 1u << (w[i] - 'A');
+        return m;
+    }
+
+    void build(std::vector<std::string> words) {
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        wordCount = words.size();
+
+        nodes.assign(1, Node{ 0, 0, 0 });
+        buildNode(0, words, 0, words.size(), 0);
+
+        buckets.assign(MAX_WORD + 1, std::vector<char>());
+        masks.assign(MAX_WORD + 1, std::vector<std::uint32_t>());
+        stats.assign(MAX_WORD + 1, BucketStats());
+        for (const std::string& w : words) {
+            int len = static_cast<int>(w.size());
+            std::vector<char>& b = buckets[len];
+            std::size_t at = b.size();
+            b.resize(at + bucketWidth(len), 0);
+            std::memcpy(b.data() + at, w.data(), w.size());
+            masks[len].push_back(letterMask(w.data(), len));
+            stats[len].add(w);
+        }
+    }
+
+    void buildNode(
+        std::uint32_t node,
+        const std::vector<std::string>& words,
+        std::size_t lo,
+        std::size_t hi,
+        std::size_t depth
+    ) {
+        if (lo < hi && words[lo].size() == depth) {
+            nodes[node].lengths = 1u;
+            ++lo;
+        }
+
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        std::uint32_t mask = 0;
+        for (std::size_t i = lo; i < hi;) {
+            char c = words[i][depth];
+            std::size_t j = i;
+            while (j < hi && words[j][depth] == c) ++j;
+            mask |= 1u << (c - 'A');
+            ranges.push_back({ i, j });
+            i = j;
+        }
+
+        const std::uint32_t first = static_cast<std::uint32_t>(nodes.size());
+        nodes[node].firstChild = first;
+        nodes[node].childMask = mask;
+        nodes.resize(first + ranges.size(), Node{ 0, 0, 0 });
+
+        for (std::size_t k = 0; k < ranges.size(); ++k) {
+            std::uint32_t child = first + static_cast<std::uint32_t>(k);
+            buildNode(child, words, ranges[k].first, ranges[k].second, depth + 1);
+            nodes[node].lengths |= nodes[child].lengths << 1;
+        }
+    }
+
+    std::uint32_t child(std::uint32_t node, int letter) const {
+        const Node& n = nodes[node];
+        return n.firstChild + static_cast<std::uint32_t>(popCount(n.childMask & ((1u << letter) - 1)));
+    }
+
+    struct Query {
+        std::string pattern;
+        std::vector<int> minLetters;   // letters pattern[p..] needs at least
+        std::vector<int> minTiles;     // rack tiles pattern[p..] needs at least
+        std::vector<char> exact;       // pattern[p..] has no '*', so exactly minLetters[p]
+        bool useRack;
+        int counts[26];
+        int blanks;
+        int tilesLeft;
+        std::size_t limit;
+        bool dedupe;
+
+        char word[MAX_WORD];
+        int length;
+        unsigned blankMask;
+        char blankLetters[MAX_WORD];
+        int blankCount;
+        std::vector<PatternMatch> out;
+        std::unordered_set<std::string> seen;
+    };
+
+    void emit(Query& q) const {
+        std::string word(q.word, q.word + q.length);
+        if (q.dedupe && !q.seen.insert(word).second) return;
+        q.out.push_back({ word, q.blankMask, std::string(q.blankLetters, q.blankLetters + q.blankCount) });
+    }
+
+    // Places `letter` at the end of q.word as a wildcard fill, from a letter
+    // tile if possible or else a blank, and carries on from (node, p).
+    void fill(Query& q, int letter, std::uint32_t node, std::size_t p) const {
+        const unsigned bit = 1u << q.length;
+        q.word[q.length++] = static_cast<char>('A' + letter);
+        if (q.useRack && q.counts[letter] > 0) {
+            --q.counts[letter];
+            --q.tilesLeft;
+            walk(q, node, p);
+            ++q.tilesLeft;
+            ++q.counts[letter];
+        }
+        else if (!q.useRack || q.blanks > 0) {
+            if (q.useRack) {
+                --q.blanks;
+                --q.tilesLeft;
+            }
+            q.blankMask |= bit;
+            q.blankLetters[q.blankCount++] = static_cast<char>('A' + letter);
+            walk(q, node, p);
+            --q.blankCount;
+            q.blankMask &= ~bit;
+            if (q.useRack) {
+                ++q.blanks;
+                ++q.tilesLeft;
+            }
+        }
+        --q.length;
+    }
+
+    void walk(Query& q, std::uint32_t node, std::size_t p) const {
+        if (q.out.size() >= q.limit) return;
+        const Node& n = nodes[node];
+        // Only go on if some word below is exactly (or, past a '*', at
+        // least) as long as the rest of the pattern needs.
+        const std::uint32_t fitting = q.exact[p]
+            ? n.lengths & (1u << q.minLetters[p])
+            : n.lengths >> q.minLetters[p];
+        if (fitting == 0) return;
+        if (q.useRack && q.minTiles[p] > q.tilesLeft) return;
+        if (q.length >= MAX_WORD && p < q.pattern.size()) return;
+
+        if (p == q.pattern.size()) {
+            if (n.lengths & 1u) emit(q);
+            return;
+        }
+
+        const char ch = q.pattern[p];
+        if (ch == '*') {
+            walk(q, node, p + 1);
+            std::uint32_t next = n.firstChild;
+            for (std::uint32_t m = n.childMask; m != 0; m &= m - 1) {
+                fill(q, lowestBit(m), next++, p);
+            }
+        }
+        else if (ch == '?') {
+            std::uint32_t next = n.firstChild;
+            for (std::uint32_t m = n.childMask; m != 0; m &= m - 1) {
+                fill(q, lowestBit(m), next++, p + 1);
+            }
+        }
+        else {
+            int letter = ch - 'A';
+            if (n.childMask & (1u << letter)) {
+                q.word[q.length++] = ch;
+                walk(q, child(node, letter), p + 1);
+                --q.length;
+            }
+        }
+    }
+
+    // Fixed-length patterns: compare every word of that length against the
+    // pattern 16 bytes at a time, wildcard bytes masked out, and only check
+    // rack tiles for the words that survive.
+    void scanBucket(Query& q) const {
+        const int len = static_cast<int>(q.pattern.size());
+        if (len > MAX_WORD) return;
+        const std::vector<char>& bucket = buckets[len];
+        const int width = bucketWidth(len);
+
+        const std::vector<std::uint32_t>& wordMasks = masks[len];
+
+        alignas(16) char pat[32] = {};
+        alignas(16) char wild[32] = {};
+        std::uint32_t fixed = 0;
+        for (int i = 0; i < len; ++i) {
+            if (q.pattern[i] == '?') wild[i] = static_cast<char>(0xFF);
+            else {
+                pat[i] = q.pattern[i];
+                fixed |= 1u << (q.pattern[i] - 'A');
+            }
+        }
+        // Without blanks a word can only use the pattern's letters and the
+        // rack's.
+        std::uint32_t outside = 0;
+        if (q.useRack && q.blanks == 0) {
+            std::uint32_t allowed = fixed;
+            for (int c = 0; c < 26; ++c) {
+                if (q.counts[c] > 0) allowed |= 1u << c;
+            }
+            outside = ~allowed & 0x3FFFFFFu;
+        }
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        const __m128i pat0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pat));
+        const __m128i pat1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pat + 16));
+        const __m128i wild0 = _mm_load_si128(reinterpret_cast<const __m128i*>(wild));
+        const __m128i wild1 = _mm_load_si128(reinterpret_cast<const __m128i*>(wild + 16));
+#endif
+
+        for (std::size_t at = 0, row = 0; at < bucket.size() && q.out.size() < q.limit; at += width, ++row) {
+            if ((wordMasks[row] & fixed) != fixed || (wordMasks[row] & outside) != 0) continue;
+            const char* w = bucket.data() + at;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            __m128i hit = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w)), pat0), wild0);
+            if (width == 32) {
+                hit = _mm_and_si128(hit, _mm_or_si128(
+                    _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w + 16)), pat1), wild1));
+            }
+            if (_mm_movemask_epi8(hit) != 0xFFFF) continue;
+#else
+            bool same = true;
+            for (int i = 0; i < width && same; ++i) {
+                same = wild[i] != 0 || w[i] == pat[i];
+            }
+            if (!same) continue;
+#endif
+            int counts[26];
+            std::memcpy(counts, q.counts, sizeof(counts));
+            int blanks = q.blanks;
+            unsigned mask = 0;
+            std::string letters;
+            bool fits = true;
+            for (int i = 0; i < len && fits; ++i) {
+                if (q.pattern[i] != '?') continue;
+                int letter = w[i] - 'A';
+                if (q.useRack && counts[letter] > 0) {
+                    --counts[letter];
+                }
+                else if (!q.useRack || blanks-- > 0) {
+                    if (i < 32) mask |= 1u << i;
+                    letters += w[i];
+                }
+                else {
+                    fits = false;
+                }
+            }
+            if (fits) q.out.push_back({ std::string(w, w + len), mask, letters });
+        }
+    }
+
+    // Words matching `pattern` (see above), at most `limit` of them. `rack`
+    // is null for an unconstrained query.
+    std::vector<PatternMatch> match(
+        const std::string& pattern,
+        const std::string* rack,
+        std::size_t limit
+    ) const {
+        Query q;
+        for (char c : pattern) {
+            char up = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            if (up == '*' && !q.pattern.empty() && q.pattern.back() == '*') continue;
+            if (up != '*' && up != '?' && (up < 'A' || up > 'Z')) return {};
+            q.pattern += up;
+        }
+
+        const std::size_t len = q.pattern.size();
+        q.minLetters.assign(len + 1, 0);
+        q.minTiles.assign(len + 1, 0);
+        q.exact.assign(len + 1, 1);
+        int stars = 0;
+        for (std::size_t p = len; p-- > 0;) {
+            bool star = q.pattern[p] == '*';
+            stars += star ? 1 : 0;
+            q.minLetters[p] = q.minLetters[p + 1] + (star ? 0 : 1);
+            q.minTiles[p] = q.minTiles[p + 1] + (q.pattern[p] == '?' ? 1 : 0);
+            q.exact[p] = q.exact[p + 1] && !star;
+        }
+        if (q.minLetters[0] > MAX_WORD) return {};
+
+        q.useRack = rack != nullptr;
+        std::fill(q.counts, q.counts + 26, 0);
+        q.blanks = 0;
+        q.tilesLeft = 0;
+        if (rack != nullptr) {
+            for (char c : *rack) {
+                if (c == '?') ++q.blanks;
+                else if (tileIndex(c) >= 0) ++q.counts[tileIndex(c)];
+                else continue;
+                ++q.tilesLeft;
+            }
+        }
+        q.limit = limit > 0 ? limit : static_cast<std::size_t>(-1);
+        q.dedupe = stars > 1;
+        q.length = 0;
+        q.blankMask = 0;
+        q.blankCount = 0;
+
+        if (nodes.empty()) return {};
+        if (stars == 0 && static_cast<int>(len) >= LONG_PATTERN) scanBucket(q);
+        else walk(q, 0, 0);
+        return q.out;
+    }
+
+    // Calls fn(word, blankMask) for every word of at most maxLen letters the
+    // rack can spell, blanks standing in for letters it lacks.
+    template <typename Fn>
+    void forEachRackWord(const std::string& rack, int maxLen, Fn fn) const {
+        int counts[26] = {};
+        int blanks = 0;
+        for (char c : rack) {
+            if (c == '?') ++blanks;
+            else if (tileIndex(c) >= 0) ++counts[tileIndex(c)];
+        }
+        std::string word;
+        if (!nodes.empty()) rackWalk(0, counts, blanks, 0u, maxLen, word, fn);
+    }
+
+    template <typename Fn>
+    void rackWalk(
+        std::uint32_t node,
+        int* counts,
+        int blanks,
+        unsigned blankMask,
+        int maxLen,
+        std::string& word,
+        Fn& fn
+    ) const {
+        const Node& n = nodes[node];
+        if ((n.lengths & 1u) && !word.empty()) fn(word, blankMask);
+        if (static_cast<int>(word.size()) >= maxLen) return;
+
+        std::uint32_t next = n.firstChild;
+        for (std::uint32_t m = n.childMask; m != 0; m &= m - 1, ++next) {
+            int letter = lowestBit(m);
+            word += static_cast<char>('A' + letter);
+            if (counts[letter] > 0) {
+                --counts[letter];
+                rackWalk(next, counts, blanks, blankMask, maxLen, word, fn);
+                ++counts[letter];
+            }
+            else if (blanks > 0) {
+                rackWalk(next, counts, blanks - 1, blankMask | (1u << (word.size() - 1)), maxLen, word, fn);
+            }
+            word.pop_back();
+        }
+    }
+
+    // Words of `len` letters (any length when 0) using every letter in
+    // `need`, at most `limit` of them (0 for all), shortest first.
+    std::vector<std::string> containing(std::uint32_t need, int len, std::size_t limit) const {
+        std::vector<std::string> out;
+        if (limit == 0) limit = static_cast<std::size_t>(-1);
+        for (int l = 1; l < static_cast<int>(masks.size()) && out.size() < limit; ++l) {
+            if (len != 0 && l != len) continue;
+            const std::vector<std::uint32_t>& wordMasks = masks[l];
+            const int width = bucketWidth(l);
+            for (std::size_t i = 0; i < wordMasks.size() && out.size() < limit; ++i) {
+                if ((wordMasks[i] & need) != need) continue;
+                const char* w = buckets[l].data() + i * width;
+                out.emplace_back(w, w + l);
+            }
+        }
+        return out;
+    }
+
+    // Same words and blank masks as forEachRackWord, found by scanning the
+    // buckets up to maxLen instead of walking the trie. A word needing
+    // letters the rack lacks is dropped on its mask unless the blanks could
+    // cover them; only the rest are counted out tile by tile.
+    template <typename Fn>
+    void scanRack(const std::string& rack, int maxLen, Fn fn) const {
+        int counts[26] = {};
+        int blanks = 0;
+        std::uint32_t have = 0;
+        for (char c : rack) {
+            if (c == '?') ++blanks;
+            else if (tileIndex(c) >= 0) {
+                ++counts[tileIndex(c)];
+                have |= 1u << tileIndex(c);
+            }
+        }
+
+        std::string word;
+        const int longest = std::min(maxLen, static_cast<int>(masks.size()) - 1);
+        for (int len = 1; len <= longest; ++len) {
+            const std::vector<std::uint32_t>& wordMasks = masks[len];
+            const int width = bucketWidth(len);
+
+            // Counts out word i, which got past its mask, tile by tile.
+            auto spell = [&](std::size_t i) {
+                const char* w = buckets[len].data() + i * width;
+                int left[26];
+                std::memcpy(left, counts, sizeof(left));
+                int blanksLeft = blanks;
+                unsigned blankMask = 0;
+                for (int k = 0; k < len; ++k) {
+                    int letter = w[k] - 'A';
+                    if (left[letter] > 0) --left[letter];
+                    else if (blanksLeft-- > 0) blankMask |= 1u << k;
+                    else return;
+                }
+                word.assign(w, w + len);
+                fn(word, blankMask);
+            };
+
+            std::size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            // Without blanks, four masks at a time.
+            if (blanks == 0) {
+                const __m128i lacks = _mm_set1_epi32(static_cast<int>(~have));
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 4 <= wordMasks.size(); i += 4) {
+                    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wordMasks.data() + i));
+                    int hits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(m, lacks), zero)));
+                    for (; hits != 0; hits &= hits - 1) spell(i + static_cast<std::size_t>(lowestBit(static_cast<std::uint32_t>(hits))));
+                }
+            }
+#endif
+            for (; i < wordMasks.size(); ++i) {
+                // Letters the rack lacks; blanks can stand in for at most
+                // `blanks` of them.
+                std::uint32_t missing = wordMasks[i] & ~have;
+                for (int b = 0; b < blanks && missing != 0; ++b) missing &= missing - 1;
+                if (missing == 0) spell(i);
+            }
+        }
+    }
+};
+
+const Lexicon& lexicon()
+{
+    static const Lexicon lex = [] {
+        std::vector<std::string> words;
+        for (const std::string& w : dictionaryWords()) {
+            if (w.empty() || w.size() > static_cast<std::size_t>(Lexicon::MAX_WORD)) continue;
+
+            std::string up;
+            bool alpha = true;
+            for (char ch : w) {
+                if (ch < 'a' || ch > 'z') { alpha = false; break; }
+                up += static_cast<char>(ch - 'a' + 'A');
+            }
+            if (alpha) words.push_back(up);
+        }
+        Lexicon l;
+        l.build(std::move(words));
+        return l;
+    }();
+    return lex;
+}
+
+std::string removeLetters(const std::string& rack, const std::string& word)
+{
+    std::string left = rack;
+    for (char c : word) {
+        std::size_t at = left.find(c);
+        if (at != std::string::npos) left.erase(at, 1);
+    }
+    return left;
+}
+
+// Calls fn(word, blankMask) once for every distinct tile multiset of the rack
+// that spells a word. Racks without blanks are answered from the anagram
+// index; blanks go through a lexicon walk. With no dictionary loaded every
+// multiset counts, matching isValidWord, and blanks play as E.
+template <typename Fn>
+void forEachRackWord(const std::string& rack, Fn fn)
+{
+    const auto& index = anagramIndex();
+    const bool anyWord = dictionaryWords().empty();
+
+    if (!anyWord && rack.find(BLANK) != std::string::npos) {
+        // Many words use the same tiles once blanks are involved; keep the
+        // first of each, keyed by its sorted tiles packed into 64 bits.
+        std::unordered_set<std::uint64_t> seen;
+        lexicon().forEachRackWord(rack, NUM_SPACES, [&](const std::string& word, unsigned blanks) {
+            char tiles[NUM_SPACES];
+            int n = 0;
+            for (std::size_t i = 0; i < word.size(); ++i) {
+                char t = (blanks & (1u << i)) ? BLANK : word[i];
+                int j = n++;
+                while (j > 0 && tiles[j - 1] > t) {
+                    tiles[j] = tiles[j - 1];
+                    --j;
+                }
+                tiles[j] = t;
+            }
+            std::uint64_t key = 0;
+            for (int i = 0; i < n; ++i) key = (key << 8) | static_cast<unsigned char>(tiles[i]);
+            if (seen.insert(key).second) fn(word, blanks);
+            });
+        return;
+    }
+
+    std::string sorted = rack;
+    std::sort(sorted.begin(), sorted.end());
+    const int n = std::min(static_cast<int>(sorted.size()), 16);
+
+    std::string key;
+    for (unsigned mask = 1; mask < (1u << n); ++mask) {
+        bool duplicate = false;
+        int bits = 0;
+        key.clear();
+        for (int i = 0; i < n; ++i) {
+            if (!(mask & (1u << i))) continue;
+            // Only the leftmost copies of a repeated letter may be chosen.
+            if (i > 0 && sorted[i] == sorted[i - 1] && !(mask & (1u << (i - 1)))) {
+                duplicate = true;
+                break;
+            }
+            key += sorted[i];
+            ++bits;
+        }
+        if (duplicate || bits > NUM_SPACES) continue;
+
+        if (anyWord) {
+            // Blanks sort first, so they are the leading letters of the key.
+            std::string word = key;
+            unsigned blanks = 0;
+            for (std::size_t i = 0; i < word.size() && word[i] == BLANK; ++i) {
+                word[i] = 'E';
+                blanks |= 1u << i;
+            }
+            fn(word, blanks);
+            continue;
+        }
+        auto it = index.find(key);
+        if (it != index.end()) fn(it->second.front(), 0u);
+    }
+}
+
+// Playable moves for a rack, best score plus leave value first (raw score
+// alone when no leave table is given); limit 0 keeps all of them.
+std::vector<Move> generateMoves(
+    const std::string& rack,
+    std::size_t limit,
+    const LeaveTable* leaves = nullptr
+) {
+    std::vector<Move> moves;
+    std::vector<int> letterScores;
+    forEachRackWord(rack, [&](const std::string& word, unsigned blanks) {
+        letterScores.resize(letterScores.size() + NUM_SPACES);
+        moves.push_back(layOutMove(word, blanks, &letterScores[letterScores.size() - NUM_SPACES]));
+        if (leaves != nullptr) moves.back().leave = leaves->value(removeLetters(rack, moves.back().tiles()));
+        });
+
+    ScoreArena& arena = turnArena();
+    arena.reset();
+    ScoreBatch batch(arena, static_cast<int>(moves.size()));
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        batch.add(&letterScores[i * NUM_SPACES], moves[i].mults,
+            std::min(static_cast<int>(moves[i].word.size()), NUM_SPACES));
+    }
+    scoreBatch(batch);
+    for (std::size_t i = 0; i < moves.size(); ++i) moves[i].score = batch.scores[i];
+
+    std::sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) {
+        if (a.score + a.leave != b.score + b.leave) return a.score + a.leave > b.score + b.leave;
+        return a.word < b.word;
+        });
+    if (limit > 0 && moves.size() > limit) moves.resize(limit);
+    return moves;
+}
+
+// The fast policy used inside rollouts: best score plus leave value.
+bool greedyMove(const std::string& rack, Move& best, const LeaveTable* leaves = nullptr)
+{
+    bool found = false;
+    forEachRackWord(rack, [&](const std::string& word, unsigned blanks) {
+        Move m = makeMove(word, blanks);
+        if (leaves != nullptr) m.leave = leaves->value(removeLetters(rack, m.tiles()));
+        if (!found || m.score + m.leave > best.score + best.leave) {
+            best = m;
+            found = true;
+        }
+        });
+    return found;
+}
+
+void refillRack(std::string& rack, LetterPool& pool, std::mt19937& rng)
+{
+    while (static_cast<int>(rack.size()) < RACK_SIZE && !pool.empty()) {
+        rack += pool.draw(rng);
+    }
+}
+
+// What one turn changed, enough to take it back: the tiles that left the
+// rack, in the order they left it, and the tiles drawn to refill it. Undoing
+// a turn touches only these, never the rest of the rack or the bag.
+struct TurnDelta {
+    int player = 0;
+    int score = 0;
+    int removedCount = 0;
+    int drawnCount = 0;
+    char removed[NUM_SPACES];
+    std::uint8_t removedAt[NUM_SPACES];   // rack index at the time it was removed
+    char drawn[RACK_SIZE];
+};
+
+// Everything a search needs to know about a game in progress, without the
+// SFML objects main() keeps for drawing it.
+struct Position {
+    std::string racks[2];
+    TileBag bag;
+    int totals[2] = { 0, 0 };
+    int toMove = 0;
+    int movesDone = 0;
+
+    // Tiles `player` cannot see: the bag plus the opponent's rack.
+    LetterPool unseenBy(int player) const {
+        LetterPool unseen = bag.pool;
+        for (char c : racks[1 - player]) unseen.add(c);
+        return unseen;
+    }
+
+    // Plays `move` (an empty word passes) for toMove, refills the rack, and
+    // returns what unmake() needs to restore this position exactly. A
+    // lookahead can walk a line of play this way instead of copying the
+    // position at every node.
+    TurnDelta make(const Move& move) {
+        TurnDelta d;
+        d.player = toMove;
+        d.score = move.score;
+        std::string& rack = racks[toMove];
+        const int tiles = std::min(static_cast<int>(move.word.size()), NUM_SPACES);
+        for (int i = 0; i < tiles; ++i) {
+            char c = (move.blanks & (1u << i)) ? BLANK : move.word[i];
+            std::size_t at = 0;
+            while (at < rack.size() && rack[at] != c) ++at;
+            if (at == rack.size()) continue;
+            d.removed[d.removedCount] = c;
+            d.removedAt[d.removedCount++] = static_cast<std::uint8_t>(at);
+            for (; at + 1 < rack.size(); ++at) rack[at] = rack[at + 1];
+            rack.pop_back();
+        }
+        totals[toMove] += move.score;
+        while (static_cast<int>(rack.size()) < RACK_SIZE && !bag.empty()) {
+            char c = bag.draw();
+            rack += c;
+            d.drawn[d.drawnCount++] = c;
+        }
+        ++movesDone;
+        toMove = 1 - toMove;
+        return d;
+    }
+
+    void unmake(const TurnDelta& d) {
+        toMove = d.player;
+        --movesDone;
+        totals[d.player] -= d.score;
+        std::string& rack = racks[d.player];
+        for (int i = d.drawnCount - 1; i >= 0; --i) {
+            rack.pop_back();
+            bag.putBack(d.drawn[i]);
+        }
+        // Shifting by hand: racks are a few letters long, and std::string's
+        // erase and insert cost more in bookkeeping than in moving them.
+        for (int i = d.removedCount - 1; i >= 0; --i) {
+            rack.push_back(d.removed[i]);
+            for (std::size_t j = rack.size() - 1; j > d.removedAt[i]; --j) rack[j] = rack[j - 1];
+            rack[d.removedAt[i]] = d.removed[i];
+        }
+    }
+};
+
+// Plays `move` for pos.toMove against one random guess at the hidden tiles
+// (opponent rack plus bag), then lets both sides play greedily for `plies`
+// more moves. Returns the mover's points minus the opponent's over the
+// rollout.
+double rolloutOnce(
+    const Position& pos,
+    const Move& move,
+    int plies,
+    const LeaveTable* leaves,
+    std::mt19937& rng
+) {
+    const int me = pos.toMove;
+    const int opp = 1 - me;
+
+    LetterPool unseen = pos.unseenBy(me);
+
+    std::string racks[2];
+    racks[me] = removeLetters(pos.racks[me], move.tiles());
+    for (std::size_t i = 0; i < pos.racks[opp].size(); ++i) racks[opp] += unseen.draw(rng);
+
+    double spread = move.score;
+    refillRack(racks[me], unseen, rng);
+
+    int moves = pos.movesDone + 1;
+    int player = opp;
+    for (int ply = 0; ply < plies && moves < MAX_MOVES; ++ply) {
+        Move m;
+        if (greedyMove(racks[player], m, leaves)) {
+            spread += (player == me) ? m.score : -m.score;
+            racks[player] = removeLetters(racks[player], m.tiles());
+            refillRack(racks[player], unseen, rng);
+        }
+        ++moves;
+        player = 1 - player;
+    }
+    return spread;
+}
+
+// Fixed set of worker threads that all run the same task together, so the
+// rollout rounds do not pay for thread start-up every time.
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex runMtx;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(int)> task;
+    unsigned long long generation;
+    int pending;
+    bool stopping;
+
+    explicit ThreadPool(int threads)
+        : generation(0)
+        , pending(0)
+        , stopping(false)
+    {
+        if (threads < 1) threads = 1;
+        for (int i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    // Runs fn(workerIndex) on every worker and returns once all have finished.
+    void runOnAll(const std::function<void(int)>& fn) {
+        std::lock_guard<std::mutex> runLock(runMtx);
+        std::unique_lock<std::mutex> lock(mtx);
+        task = fn;
+        pending = size();
+        ++generation;
+        wake.notify_all();
+        done.wait(lock, [this] { return pending == 0; });
+        task = nullptr;
+    }
+
+    void workerLoop(int index) {
+        unsigned long long seen = 0;
+        for (;;) {
+            std::function<void(int)> fn;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                fn = task;
+            }
+            fn(index);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (--pending == 0) done.notify_all();
+            }
+        }
+    }
+};
+
+struct RunningStat {
+    long long n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x) {
+        ++n;
+        double d = x - mean;
+        mean += d / static_cast<double>(n);
+        m2 += d * (x - mean);
+    }
+
+    void merge(const RunningStat& o) {
+        if (o.n == 0) return;
+        long long total = n + o.n;
+        double d = o.mean - mean;
+        mean += d * static_cast<double>(o.n) / static_cast<double>(total);
+        m2 += o.m2 + d * d * static_cast<double>(n) * static_cast<double>(o.n) /
+            static_cast<double>(total);
+        n = total;
+    }
+
+    double halfWidth(double z) const {
+        if (n < 2) return 0.0;
+        return z * std::sqrt(m2 / static_cast<double>(n - 1) / static_cast<double>(n));
+    }
+};
+
+struct RolloutConfig {
+    int candidates = 8;      // moves to simulate, best score plus leave value first
+    int plies = 3;           // greedy moves played after the candidate
+    int batch = 32;          // rollouts per candidate between stop checks
+    int minRollouts = 64;    // per candidate before anything is pruned
+    int maxRollouts = 2000;  // per candidate
+    double z = 1.96;         // confidence interval width in standard deviations
+    unsigned seed = 0;       // 0 = seed from std::random_device
+    const LeaveTable* leaves = nullptr;   // ranks candidates and steers greedy play
+};
+
+struct MoveEquity {
+    Move move;
+    double mean;
+    double halfWidth;
+    long long rollouts;
+};
+
+struct RolloutResult {
+    std::vector<MoveEquity> moves;   // best equity first
+    long long rollouts = 0;
+    double seconds = 0.0;
+    double rolloutsPerSec = 0.0;
+    bool stoppedEarly = false;
+    bool cancelled = false;
+};
+
+// Monte Carlo equity for the mover's best moves by score plus leave value. Rollouts run in
+// rounds of cfg.batch per surviving candidate across the pool, each worker
+// with its own RNG; after every round a candidate whose upper confidence
+// bound falls below the leader's lower bound is dropped, and the search stops
+// once a single candidate is left or all reach cfg.maxRollouts.
+//
+// `cancel`, when given, is polled between rollouts and ends the search with
+// whatever has been gathered so far. `onRound`, when given, receives the
+// standings after every round so callers can show an anytime answer.
+RolloutResult evaluateMoves(
+    const Position& pos,
+    const RolloutConfig& cfg,
+    ThreadPool& pool,
+    const std::atomic<bool>* cancel = nullptr,
+    const std::function<void(const RolloutResult&)>& onRound = {}
+) {
+    auto start = std::chrono::steady_clock::now();
+    RolloutResult res;
+
+    std::vector<Move> cands = generateMoves(pos.racks[pos.toMove], cfg.candidates, cfg.leaves);
+    std::vector<RunningStat> stats(cands.size());
+    std::vector<char> active(cands.size(), 1);
+
+    unsigned seed = cfg.seed ? cfg.seed : std::random_device{}();
+    std::vector<std::mt19937> rngs;
+    for (int w = 0; w < pool.size(); ++w) {
+        std::seed_seq seq{ seed, static_cast<unsigned>(w) };
+        rngs.emplace_back(seq);
+    }
+
+    auto cancelled = [&]() {
+        return cancel != nullptr && cancel->load(std::memory_order_relaxed);
+        };
+
+    auto summarize = [&]() {
+        res.moves.clear();
+        for (std::size_t c = 0; c < cands.size(); ++c) {
+            res.moves.push_back({ cands[c], stats[c].mean, stats[c].halfWidth(cfg.z), stats[c].n });
+        }
+        std::sort(res.moves.begin(), res.moves.end(), [](const MoveEquity& a, const MoveEquity& b) {
+            return a.mean > b.mean;
+            });
+        res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (res.seconds > 0.0) res.rolloutsPerSec = static_cast<double>(res.rollouts) / res.seconds;
+        };
+
+    std::vector<int> work;
+    while (!cands.empty() && !cancelled()) {
+        work.clear();
+        for (std::size_t c = 0; c < cands.size(); ++c) {
+            if (!active[c] || stats[c].n >= cfg.maxRollouts) continue;
+            for (int b = 0; b < cfg.batch; ++b) work.push_back(static_cast<int>(c));
+        }
+        if (work.empty()) break;
+
+        const int total = static_cast<int>(work.size());
+        std::atomic<int> next(0);
+        std::atomic<long long> done(0);
+        std::mutex mergeMtx;
+        pool.runOnAll([&](int w) {
+            std::vector<RunningStat> local(cands.size());
+            long long ran = 0;
+            for (int i = next++; i < total && !cancelled(); i = next++) {
+                int c = work[i];
+                local[c].add(rolloutOnce(pos, cands[c], cfg.plies, cfg.leaves, rngs[w]));
+                ++ran;
+            }
+            done += ran;
+            std::lock_guard<std::mutex> lock(mergeMtx);
+            for (std::size_t c = 0; c < cands.size(); ++c) stats[c].merge(local[c]);
+            });
+        res.rollouts += done.load();
+        if (cancelled()) {
+            res.cancelled = true;
+            break;
+        }
+
+        int best = -1;
+        int alive = 0;
+        bool ready = true;
+        for (std::size_t c = 0; c < cands.size(); ++c) {
+            if (!active[c]) continue;
+            ++alive;
+            if (stats[c].n < cfg.minRollouts) ready = false;
+            if (best < 0 || stats[c].mean > stats[best].mean) best = static_cast<int>(c);
+        }
+
+        if (ready) {
+            double bestLower = stats[best].mean - stats[best].halfWidth(cfg.z);
+            for (std::size_t c = 0; c < cands.size(); ++c) {
+                if (!active[c] || static_cast<int>(c) == best) continue;
+                if (stats[c].mean + stats[c].halfWidth(cfg.z) < bestLower) {
+                    active[c] = 0;
+                    --alive;
+                }
+            }
+        }
+        if (ready && alive == 1) {
+            res.stoppedEarly = cands.size() > 1;
+            break;
+        }
+        if (onRound) {
+            summarize();
+            onRound(res);
+        }
+    }
+    if (cancelled()) res.cancelled = true;
+
+    summarize();
+    return res;
+}
+
+void printRolloutResult(std::ostream& out, int player, const RolloutResult& res)
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << "Move equities for player " << (player + 1) << ":\n";
+    for (const MoveEquity& me : res.moves) {
+        out << "  " << std::setw(8) << std::left << me.move.label() << std::right
+            << " score " << std::setw(6) << me.move.score
+            << " leave " << std::fixed << std::setprecision(1) << std::setw(6) << me.move.leave
+            << "  equity " << std::fixed << std::setprecision(1) << std::setw(8) << me.mean
+            << " +/- " << std::setw(6) << me.halfWidth
+            << "  (" << me.rollouts << " rollouts)\n";
+    }
+    out << std::setprecision(3) << res.rollouts << " rollouts in "
+        << res.seconds << " s (" << static_cast<long long>(res.rolloutsPerSec)
+        << " rollouts/sec)" << (res.stoppedEarly ? ", stopped early" : "") << "\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+// Next-draw odds and refill expectations from `player`'s point of view.
+void printDrawOdds(std::ostream& out, const Position& pos, int player)
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    LetterPool unseen = pos.unseenBy(player);
+    const int refill = RACK_SIZE;
+    out << "Unseen tiles: " << unseen.size() << "\n  next draw:";
+    out << std::fixed << std::setprecision(1);
+    for (int kind = 0; kind < TILE_KINDS; ++kind) {
+        char c = tileChar(kind);
+        if (unseen.count(c) > 0) out << " " << c << " " << 100.0 * unseen.probNext(c) << "%";
+    }
+    out << "\n  in a " << refill << "-tile refill: P(Q) " << 100.0 * unseen.probAtLeast('Q', 1, refill)
+        << "%, P(2+ E) " << 100.0 * unseen.probAtLeast('E', 2, refill)
+        << "%, expected face value " << unseen.expectedDrawScore(refill) << "\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+// Bounded single-producer/single-consumer ring buffer. One thread only
+// pushes and one other thread only pops; neither side ever locks or waits.
+template <typename T, std::size_t Capacity>
+struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    T slots[Capacity];
+    alignas(64) std::atomic<std::size_t> head{ 0 };
+    alignas(64) std::atomic<std::size_t> tail{ 0 };
+
+    bool push(const T& v) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        slots[t & (Capacity - 1)] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        out = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+struct Hint {
+    unsigned long long request;   // HintEngine::request() id this answers
+    bool found;                   // false when the rack spells nothing
+    Move move;
+    double equity;
+    double halfWidth;
+    long long rollouts;
+    bool final;
+};
+
+// Background search for the player to move. The game thread calls request()
+// whenever the rack or row changes and cancel() when a tile is picked up or a
+// move is committed; both return at once. The worker answers with the greedy
+// move first, then the leader after every rollout round, pushing each through
+// a lock-free queue the game thread drains with take(). Should the queue be
+// full, results wait in a single overflow slot, newest first, so a final
+// hint is never dropped.
+struct HintEngine {
+    ThreadPool& pool;
+    RolloutConfig cfg;
+    SpscQueue<Hint, 64> results;
+    std::mutex overflowMtx;
+    Hint overflow;
+    bool overflowed = false;
+
+    std::mutex mtx;
+    std::condition_variable wake;
+    Position pending;
+    bool hasPending;
+    bool stopping;
+    unsigned long long latest;
+    std::atomic<bool> cancelFlag;
+    std::atomic<bool> logNext;
+    std::thread worker;
+
+    explicit HintEngine(ThreadPool& p)
+        : pool(p)
+        , hasPending(false)
+        , stopping(false)
+        , latest(0)
+        , cancelFlag(false)
+        , logNext(false)
+    {
+        worker = std::thread([this] { run(); });
+    }
+
+    ~HintEngine() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+            cancelFlag = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    HintEngine(const HintEngine&) = delete;
+    HintEngine& operator=(const HintEngine&) = delete;
+
+    // Replaces any queued or running search; returns the id hints will carry.
+    unsigned long long request(const Position& pos) {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending = pos;
+        hasPending = true;
+        cancelFlag = true;
+        wake.notify_one();
+        return ++latest;
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mtx);
+        hasPending = false;
+        cancelFlag = true;
+        ++latest;
+    }
+
+    void run() {
+        for (;;) {
+            Position pos;
+            unsigned long long id;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                wake.wait(lock, [this] { return stopping || hasPending; });
+                if (stopping) return;
+                pos = pending;
+                hasPending = false;
+                id = latest;
+                cancelFlag = false;
+            }
+            search(pos, id);
+        }
+    }
+
+    // Worker side. Once a result has overflowed, later ones replace it
+    // rather than overtake it through the queue.
+    void deliver(const Hint& h) {
+        std::lock_guard<std::mutex> lock(overflowMtx);
+        if (!overflowed && results.push(h)) return;
+        overflow = h;
+        overflowed = true;
+    }
+
+    // Game thread side: the next result, oldest first.
+    bool take(Hint& h) {
+        if (results.pop(h)) return true;
+        // Anything queued before the overflow still comes first.
+        std::lock_guard<std::mutex> lock(overflowMtx);
+        if (results.pop(h)) return true;
+        if (!overflowed) return false;
+        h = overflow;
+        overflowed = false;
+        return true;
+    }
+
+    void post(unsigned long long id, const MoveEquity& me, bool final) {
+        deliver({ id, true, me.move, me.mean, me.halfWidth, me.rollouts, final });
+    }
+
+    void search(const Position& pos, unsigned long long id) {
+        Move greedy;
+        if (!greedyMove(pos.racks[pos.toMove], greedy, cfg.leaves)) {
+            deliver({ id, false, Move(), 0.0, 0.0, 0, true });
+            return;
+        }
+        post(id, { greedy, greedy.score + static_cast<double>(greedy.leave), 0.0, 0 }, false);
+
+        RolloutResult res = evaluateMoves(pos, cfg, pool, &cancelFlag,
+            [&](const RolloutResult& r) { post(id, r.moves.front(), false); });
+        if (res.cancelled || res.moves.empty()) return;
+
+        post(id, res.moves.front(), true);
+        if (logNext.exchange(false)) {
+            printRolloutResult(std::cout, pos.toMove, res);
+            printDrawOdds(std::cout, pos, pos.toMove);
+        }
+    }
+};
+
+// Single-writer, single-reader triple buffer. The writer fills back() and
+// publish()es it; the reader's acquire() swaps in the newest published slot
+// as front(). With three slots there is always one to write, one being read
+// and one holding the latest finished value, so neither side ever waits.
+template <typename T>
+struct TripleBuffer {
+    static constexpr unsigned FRESH = 4;   // set in `middle` until the reader takes it
+
+    T slots[3]{};
+    unsigned backIdx = 0;
+    unsigned frontIdx = 1;
+    std::atomic<unsigned> middle{ 2 };
+
+    T& back() { return slots[backIdx]; }
+    const T& front() const { return slots[frontIdx]; }
+
+    void publish() {
+        backIdx = middle.exchange(backIdx | FRESH, std::memory_order_acq_rel) & 3u;
+    }
+
+    // True when front() changed.
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        frontIdx = middle.exchange(frontIdx, std::memory_order_acq_rel) & 3u;
+        return true;
+    }
+};
+
+// Mouse and key input as the render thread forwards it to the game thread,
+// positions already mapped to world coordinates.
+struct InputEvent {
+    enum class Kind { Press, Release, Move, Key };
+    Kind kind;
+    sf::Mouse::Button button;
+    sf::Vector2f position;
+    sf::Keyboard::Key key;
+    bool shift;                                     // Shift held with `key`
+    std::chrono::steady_clock::time_point polled;   // when pollEvent returned it
+};
+
+// Folds a mouse move into the one before it: the later position wins, the
+// earlier timestamp stays, so latency is measured from the oldest input the
+// merged event stands for.
+void mergeMove(InputEvent& into, const InputEvent& later)
+{
+    std::chrono::steady_clock::time_point polled = std::min(into.polled, later.polled);
+    into = later;
+    into.polled = polled;
+}
+
+// Log-linear histogram of microsecond latencies: exact below 4 us, then four
+// buckets per power of two, so every sample lands within 25% of its value.
+struct LatencyHistogram {
+    static const int BUCKETS = 120;
+
+    long long counts[BUCKETS] = {};
+    long long n = 0;
+    double sumUs = 0.0;
+    double maxUs = 0.0;
+
+    static int bucketOf(std::uint64_t us) {
+        if (us < 4) return static_cast<int>(us);
+        int log = 2;
+        while ((us >> (log + 1)) != 0) ++log;
+        int b = (log - 1) * 4 + static_cast<int>((us >> (log - 2)) & 3u);
+        return std::min(b, BUCKETS - 1);
+    }
+
+    static double lowerUs(int b) {
+        if (b < 4) return b;
+        return std::ldexp(4.0 + b % 4, b / 4 - 1);
+    }
+
+    void add(std::chrono::steady_clock::duration d) {
+        double us = std::chrono::duration<double, std::micro>(d).count();
+        ++counts[bucketOf(static_cast<std::uint64_t>(std::max(0.0, us)))];
+        ++n;
+        sumUs += us;
+        maxUs = std::max(maxUs, us);
+    }
+
+    // Upper edge of the bucket holding the p-th fraction of samples.
+    double percentileUs(double p) const {
+        long long want = static_cast<long long>(std::ceil(p * static_cast<double>(n)));
+        long long seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= want && seen > 0) return std::min(lowerUs(b + 1), maxUs);
+        }
+        return maxUs;
+    }
+
+    void print(std::ostream& out) const {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(2);
+        s << "Input-to-display latency over " << n << " frames: mean "
+            << (n > 0 ? sumUs / static_cast<double>(n) / 1000.0 : 0.0) << " ms, p50 "
+            << percentileUs(0.50) / 1000.0 << " ms, p95 " << percentileUs(0.95) / 1000.0 << " ms, p99 "
+            << percentileUs(0.99) / 1000.0 << " ms, max " << maxUs / 1000.0 << " ms\n";
+
+        long long most = *std::max_element(counts, counts + BUCKETS);
+        for (int b = 0; b < BUCKETS; ++b) {
+            if (counts[b] == 0) continue;
+            int bar = static_cast<int>((counts[b] * 40 + most - 1) / most);
+            s << std::setw(9) << lowerUs(b) / 1000.0 << " - " << std::setw(9) << lowerUs(b + 1) / 1000.0
+                << " ms " << std::setw(8) << counts[b] << " " << std::string(bar, '#') << "\n";
+        }
+        out << s.str();
+    }
+};
+
+const int MAX_RACK_TILES = 16;
+const int MULT_BUTTONS = 4;
+
+// Everything one frame draws, copied out of the game state by the game
+// thread. Plain values only, so a published snapshot shares nothing with the
+// state it came from.
+struct FrameSnapshot {
+    TileState tiles[2][MAX_RACK_TILES];
+    int tileCount[2];
+    sf::Color spaceFill[NUM_SPACES];
+    bool buttonPressed[MULT_BUTTONS];
+    int placedScore;
+    int totals[2];
+    int currentPlayer;
+    int movesDone;
+    int bagSize;
+    int selectedButton;
+    bool gameOver;
+    char hint[128];
+    unsigned long long inputSeq;   // inputs applied so far; see InputStamps
+};
+
+// When each input was polled, by its sequence number, written by the game
+// thread as it applies input. A snapshot carries the number of the newest
+// input in it, so the render thread can time every input it has not shown
+// yet even if snapshots it never drew went by in between. Only the last
+// SIZE stamps are kept; older ones are timed from the oldest still there.
+struct InputStamps {
+    static const unsigned long long SIZE = 256;
+
+    std::atomic<long long> polled[SIZE];
+
+    InputStamps() {
+        for (auto& p : polled) p.store(0, std::memory_order_relaxed);
+    }
+
+    void record(unsigned long long seq, std::chrono::steady_clock::time_point t) {
+        polled[seq % SIZE].store(t.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    // Poll time of the first input after `shown`, up to `newest`.
+    std::chrono::steady_clock::time_point oldestAfter(unsigned long long shown, unsigned long long newest) const {
+        unsigned long long seq = std::max(shown + 1, newest >= SIZE ? newest - SIZE + 1 : 1ull);
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(polled[seq % SIZE].load(std::memory_order_relaxed)));
+    }
+};
+
+// Every multiset of up to LEAVE_MAX_TILES tiles the standard bag can supply,
+// as sorted letters.
+void collectLeaves(
+    const LetterPool& full,
+    int fromKind,
+    std::string& current,
+    std::vector<std::string>& out
+) {
+    out.push_back(current);
+    if (static_cast<int>(current.size()) == LEAVE_MAX_TILES) return;
+
+    for (int kind = fromKind; kind < TILE_KINDS; ++kind) {
+        char c = tileChar(kind);
+        int used = static_cast<int>(std::count(current.begin(), current.end(), c));
+        if (used >= full.counts[kind]) continue;
+        current += c;
+        collectLeaves(full, kind, current, out);
+        current.pop_back();
+    }
+}
+
+// Builds the leave table at `path`. For every leave the standard bag allows,
+// the rest of the rack is dealt `samples` times from the bag minus those
+// tiles and the greedy move is played; the leave's value is its mean
+// next-turn score minus that of an empty leave. Leaves are shared out across
+// the pool, each worker with its own RNG.
+bool buildLeaveTable(const std::string& path, int samples, ThreadPool& pool, unsigned seed)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<char> tiles;
+    fillStandardBag(tiles);
+    LetterPool full;
+    for (char c : tiles) full.add(c);
+
+    std::vector<std::string> leaves;
+    std::string current;
+    collectLeaves(full, 0, current, leaves);
+
+    const LeaveIndexer& indexer = leaveIndexer();
+    std::vector<float> values(indexer.entries(), 0.f);
+    std::cout << "Simulating " << leaves.size() << " leaves x " << samples
+        << " turns on " << pool.size() << " threads\n";
+
+    std::vector<std::mt19937> rngs;
+    for (int w = 0; w < pool.size(); ++w) {
+        std::seed_seq seq{ seed, static_cast<unsigned>(w) };
+        rngs.emplace_back(seq);
+    }
+
+    const int total = static_cast<int>(leaves.size());
+    const int chunk = 256;
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+    pool.runOnAll([&](int w) {
+        int kinds[LEAVE_MAX_TILES];
+        for (int begin = next.fetch_add(chunk); begin < total; begin = next.fetch_add(chunk)) {
+            int end = std::min(begin + chunk, total);
+            for (int i = begin; i < end; ++i) {
+                const std::string& leave = leaves[i];
+                LetterPool bag = full;
+                for (char c : leave) bag.remove(c);
+
+                double sum = 0.0;
+                for (int s = 0; s < samples; ++s) {
+                    LetterPool draw = bag;
+                    std::string rack = leave;
+                    refillRack(rack, draw, rngs[w]);
+                    Move m;
+                    if (greedyMove(rack, m)) sum += m.score;
+                }
+
+                int n = static_cast<int>(leave.size());
+                for (int k = 0; k < n; ++k) kinds[k] = tileIndex(leave[k]);
+                values[indexer.index(kinds, n)] = static_cast<float>(sum / samples);
+            }
+
+            int before = done.fetch_add(end - begin);
+            if ((before * 20LL) / total != ((before + end - begin) * 20LL) / total) {
+                std::cout << "  " << (100LL * (before + end - begin)) / total << "%\n";
+            }
+        }
+        });
+
+    const float baseline = values[0];
+    for (const std::string& leave : leaves) {
+        int kinds[LEAVE_MAX_TILES];
+        int n = static_cast<int>(leave.size());
+        for (int k = 0; k < n; ++k) kinds[k] = tileIndex(leave[k]);
+        values[indexer.index(kinds, n)] -= baseline;
+    }
+
+    LeaveTableHeader header;
+    std::memcpy(header.magic, "WBLV", 4);
+    header.version = LEAVE_TABLE_VERSION;
+    header.kinds = TILE_KINDS;
+    header.maxTiles = LEAVE_MAX_TILES;
+    header.entries = indexer.entries();
+    header.samples = static_cast<std::uint32_t>(samples);
+    header.baseline = baseline;
+    header.reserved = 0;
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values.data()),
+        static_cast<std::streamsize>(values.size() * sizeof(float)));
+    if (!out) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    out.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << path << ": " << header.entries << " entries, baseline "
+        << baseline << ", " << static_cast<long long>(static_cast<double>(total) * samples / seconds)
+        << " simulated turns/sec, " << seconds << " s\n";
+    return true;
+}
+
+// Times random lookups against a mapped table.
+void benchLeaveTable(const LeaveTable& table)
+{
+    std::mt19937 rng(1);
+    std::vector<std::string> leaves(4096);
+    for (std::string& leave : leaves) {
+        int n = static_cast<int>(rng() % (LEAVE_MAX_TILES + 1));
+        for (int i = 0; i < n; ++i) leave += tileChar(static_cast<int>(rng() % TILE_KINDS));
+    }
+
+    const int lookups = 10000000;
+    float sink = 0.f;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i) sink += table.value(leaves[i & 4095]);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Leave lookup: " << ns / lookups << " ns (checksum " << sink << ")\n";
+}
+
+// ---- Game history ----
+//
+// The history file is an append-only column store with one row per move.
+// Rows are written in blocks of up to HISTORY_BLOCK_ROWS. Each column of a
+// block is bit-packed against the block's minimum (frame of reference) and
+// carries its min and max, so a scan decodes only the columns a query reads
+// and skips whole blocks the stats rule out. Words are stored by id; each
+// block lists the words it uses for the first time, and id 0 is a pass.
+//
+//   header   "WBHS", version
+//   block    HistoryBlockHeader, new words (NUL-terminated), column payloads
+
+const std::uint32_t HISTORY_VERSION = 1;
+const std::uint32_t HISTORY_BLOCK_ROWS = 65536;
+
+enum HistoryColumn {
+    COL_GAME,      // game id, counting up from 0 across the file
+    COL_MOVE,      // move number within the game
+    COL_PLAYER,    // seat that moved, 0 moves first
+    COL_WORD,      // word id, 0 for a pass
+    COL_BLANKS,    // bit i set when letter i was a blank
+    COL_TILES,     // letters placed
+    COL_MULTS,     // Mult under letter i in bits 3i..3i+2
+    COL_SCORE,
+    COL_BAG,       // tiles in the bag before the move
+    HISTORY_COLUMNS
+};
+
+struct HistoryColumnMeta {
+    std::uint32_t min;
+    std::uint32_t max;
+    std::uint32_t bits;    // per value, after subtracting min
+    std::uint32_t bytes;   // payload size, a whole number of 64-bit words
+};
+
+struct HistoryBlockHeader {
+    char magic[4];         // "WBHB"
+    std::uint32_t rows;
+    std::uint32_t newWords;
+    std::uint32_t wordBytes;
+    HistoryColumnMeta cols[HISTORY_COLUMNS];
+};
+
+// One move of a finished game, as the history stores it.
+struct MoveRecord {
+    int player;
+    Move move;       // empty word for a pass
+    int bagSize;     // tiles in the bag before the move
+};
+
+void packColumn(const std::vector<std::uint32_t>& values, HistoryColumnMeta& meta, std::vector<std::uint64_t>& out)
+{
+    meta.min = values.empty() ? 0 : *std::min_element(values.begin(), values.end());
+    meta.max = values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+    meta.bits = 0;
+    while (meta.bits < 32 && (static_cast<std::uint64_t>(meta.max - meta.min) >> meta.bits) != 0) ++meta.bits;
+
+    std::size_t words = (values.size() * meta.bits + 63) / 64;
+    out.assign(words, 0);
+    for (std::size_t i = 0; i < values.size() && meta.bits > 0; ++i) {
+        std::uint64_t v = values[i] - meta.min;
+        std::size_t bit = i * meta.bits;
+        out[bit / 64] |= v << (bit % 64);
+        if (bit % 64 + meta.bits > 64) out[bit / 64 + 1] |= v >> (64 - bit % 64);
+    }
+    meta.bytes = static_cast<std::uint32_t>(words * sizeof(std::uint64_t));
+}
+
+// Decodes `rows` values packed by packColumn. `packed` must hold one spare
+// 64-bit word past the payload, since a value is read with the 8 bytes that
+// follow its first byte. Values are at most 32 bits, so those 8 bytes always
+// cover it: the AVX2 path gathers four rows at a time, shifts each lane by
+// its own bit offset and masks. SSE2 has neither gathers nor per-lane
+// shifts, so without AVX2 every row takes the scalar loop.
+void unpackColumn(const std::uint64_t* packed, const HistoryColumnMeta& meta, std::uint32_t rows, std::uint32_t* out)
+{
+    if (meta.bits == 0) {
+        std::fill(out, out + rows, meta.min);
+        return;
+    }
+    const std::uint64_t mask = (std::uint64_t(1) << meta.bits) - 1;
+    std::uint32_t i = 0;
+#if defined(__AVX2__)
+    const long long* bytes = reinterpret_cast<const long long*>(packed);
+    const __m256i bits = _mm256_set1_epi64x(meta.bits);
+    const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+    const __m256i seven = _mm256_set1_epi64x(7);
+    const __m256i lowMask = _mm256_set1_epi64x(static_cast<long long>(mask));
+    const __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128i base = _mm_set1_epi32(static_cast<int>(meta.min));
+    for (; i + 4 <= rows; i += 4) {
+        __m256i bit = _mm256_mul_epu32(_mm256_add_epi64(_mm256_set1_epi64x(i), lanes), bits);
+        __m256i v = _mm256_i64gather_epi64(bytes, _mm256_srli_epi64(bit, 3), 1);
+        v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(bit, seven)), lowMask);
+        __m128i low = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, evens));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi32(low, base));
+    }
+#endif
+    for (; i < rows; ++i) {
+        std::size_t bit = static_cast<std::size_t>(i) * meta.bits;
+        std::size_t word = bit / 64;
+        unsigned shift = static_cast<unsigned>(bit % 64);
+        std::uint64_t v = packed[word] >> shift;
+        if (shift + meta.bits > 64) v |= packed[word + 1] << (64 - shift);
+        out[i] = static_cast<std::uint32_t>(v & mask) + meta.min;
+    }
+}
+
+// Streams a history file one block at a time. next() reads a block header
+// and its new words; the caller then either load()s the columns it needs
+// or skip()s the block.
+struct HistoryReader {
+    std::ifstream in;
+    std::vector<std::string> words{ "" };
+    HistoryBlockHeader header{};
+    std::streamoff fileSize = 0;
+    std::streamoff payloadStart = 0;
+    std::streamoff goodEnd = 0;          // end of the last complete block
+    std::vector<std::uint64_t> scratch;
+
+    bool open(const std::string& path) {
+        in.open(path, std::ios::binary | std::ios::ate);
+        fileSize = in.tellg();
+        in.seekg(0);
+        char magic[4];
+        std::uint32_t version = 0;
+        if (!in.read(magic, 4) || !in.read(reinterpret_cast<char*>(&version), sizeof(version))) return false;
+        if (std::memcmp(magic, "WBHS", 4) != 0 || version != HISTORY_VERSION) {
+            std::cerr << "[WARN] " << path << " is not a version " << HISTORY_VERSION << " history file\n";
+            return false;
+        }
+        goodEnd = in.tellg();
+        return true;
+    }
+
+    bool next() {
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if (std::memcmp(header.magic, "WBHB", 4) != 0) return false;
+
+        std::string list(header.wordBytes, '\0');
+        if (!in.read(&list[0], static_cast<std::streamsize>(list.size()))) return false;
+        // The block's words only count once its payload is known to be all
+        // there; a cut-off block must not leave ids behind that no later
+        // reader will see.
+        std::vector<std::string> fresh;
+        std::size_t at = 0;
+        for (std::uint32_t w = 0; w < header.newWords && at < list.size(); ++w) {
+            std::size_t end = list.find('\0', at);
+            if (end == std::string::npos) return false;
+            fresh.push_back(list.substr(at, end - at));
+            at = end + 1;
+        }
+
+        payloadStart = in.tellg();
+        std::streamoff end = payloadStart;
+        for (const HistoryColumnMeta& m : header.cols) end += m.bytes;
+        if (end > fileSize) return false;
+        words.insert(words.end(), fresh.begin(), fresh.end());
+        goodEnd = end;
+        in.seekg(goodEnd);
+        return true;
+    }
+
+    // Decodes column `col` of the current block into out[0..rows). Returns
+    // false when the payload can't be read or, for COL_WORD, names a word
+    // id the file never defined.
+    bool load(int col, std::vector<std::uint32_t>& out) {
+        std::streamoff at = payloadStart;
+        for (int c = 0; c < col; ++c) at += header.cols[c].bytes;
+        const HistoryColumnMeta& meta = header.cols[col];
+        if (col == COL_WORD && meta.max >= words.size()) return false;
+        scratch.assign(meta.bytes / sizeof(std::uint64_t) + 1, 0);
+        in.seekg(at);
+        bool ok = static_cast<bool>(in.read(reinterpret_cast<char*>(scratch.data()), meta.bytes));
+        in.clear();
+        in.seekg(goodEnd);
+        if (!ok) return false;
+        out.resize(header.rows);
+        unpackColumn(scratch.data(), meta, header.rows, out.data());
+        return true;
+    }
+};
+
+// Buffers finished games and appends them to the history file a block at a
+// time. open() picks up the word ids and game count already in the file
+// and cuts off a block left half-written by a crash.
+struct HistoryWriter {
+    std::string path;
+    std::uint32_t nextGame = 0;
+    std::unordered_map<std::string, std::uint32_t> wordIds{ { "", 0 } };
+    std::vector<std::string> newWords;
+    std::vector<std::uint32_t> cols[HISTORY_COLUMNS];
+
+    HistoryWriter() = default;
+    ~HistoryWriter() { flush(); }
+
+    HistoryWriter(const HistoryWriter&) = delete;
+    HistoryWriter& operator=(const HistoryWriter&) = delete;
+
+    bool isOpen() const {
+        return !path.empty();
+    }
+
+    bool open(const std::string& file) {
+        path.clear();
+        std::error_code ec;
+        if (!std::filesystem::exists(file, ec)) {
+            std::ofstream out(file, std::ios::binary);
+            out.write("WBHS", 4);
+            out.write(reinterpret_cast<const char*>(&HISTORY_VERSION), sizeof(HISTORY_VERSION));
+            if (!out) {
+                std::cerr << "[WARN] Could not create history file " << file << "\n";
+                return false;
+            }
+        }
+        else {
+            HistoryReader reader;
+            if (!reader.open(file)) return false;
+            bool any = false;
+            while (reader.next()) {
+                if (reader.header.rows > 0) {
+                    nextGame = std::max(nextGame, reader.header.cols[COL_GAME].max + 1);
+                    any = true;
+                }
+            }
+            if (!any) nextGame = 0;
+            for (std::size_t id = 0; id < reader.words.size(); ++id) {
+                wordIds[reader.words[id]] = static_cast<std::uint32_t>(id);
+            }
+            std::streamoff good = reader.goodEnd;
+            reader.in.close();
+            if (std::filesystem::file_size(file, ec) > static_cast<std::uintmax_t>(good)) {
+                std::cerr << "[WARN] Dropping an incomplete block at the end of " << file << "\n";
+                std::filesystem::resize_file(file, static_cast<std::uintmax_t>(good), ec);
+            }
+        }
+        path = file;
+        return true;
+    }
+
+    void addGame(const std::vector<MoveRecord>& moves) {
+        if (!isOpen() || moves.empty()) return;
+        const std::uint32_t game = nextGame++;
+        for (std::size_t i = 0; i < moves.size(); ++i) {
+            const MoveRecord& r = moves[i];
+            auto id = wordIds.find(r.move.word);
+            if (id == wordIds.end()) {
+                id = wordIds.emplace(r.move.word, static_cast<std::uint32_t>(wordIds.size())).first;
+                newWords.push_back(r.move.word);
+            }
+            std::uint32_t mults = 0;
+            for (int k = 0; k < NUM_SPACES; ++k) mults |= static_cast<std::uint32_t>(r.move.mults[k]) << (3 * k);
+
+            cols[COL_GAME].push_back(game);
+            cols[COL_MOVE].push_back(static_cast<std::uint32_t>(i));
+            cols[COL_PLAYER].push_back(static_cast<std::uint32_t>(r.player));
+            cols[COL_WORD].push_back(id->second);
+            cols[COL_BLANKS].push_back(r.move.blanks);
+            cols[COL_TILES].push_back(static_cast<std::uint32_t>(r.move.word.size()));
+            cols[COL_MULTS].push_back(mults);
+            cols[COL_SCORE].push_back(static_cast<std::uint32_t>(std::max(0, r.move.score)));
+            cols[COL_BAG].push_back(static_cast<std::uint32_t>(r.bagSize));
+        }
+        if (cols[COL_GAME].size() >= HISTORY_BLOCK_ROWS) flush();
+    }
+
+    void flush() {
+        if (!isOpen() || cols[COL_GAME].empty()) return;
+
+        HistoryBlockHeader header{};
+        std::memcpy(header.magic, "WBHB", 4);
+        header.rows = static_cast<std::uint32_t>(cols[COL_GAME].size());
+        header.newWords = static_cast<std::uint32_t>(newWords.size());
+        std::string list;
+        for (const std::string& w : newWords) {
+            list += w;
+            list += '\0';
+        }
+        header.wordBytes = static_cast<std::uint32_t>(list.size());
+
+        std::vector<std::uint64_t> packed[HISTORY_COLUMNS];
+        for (int c = 0; c < HISTORY_COLUMNS; ++c) packColumn(cols[c], header.cols[c], packed[c]);
+
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(list.data(), static_cast<std::streamsize>(list.size()));
+        for (int c = 0; c < HISTORY_COLUMNS; ++c) {
+            out.write(reinterpret_cast<const char*>(packed[c].data()), header.cols[c].bytes);
+        }
+        if (!out) std::cerr << "[WARN] Could not append to history file " << path << "\n";
+
+        newWords.clear();
+        for (std::vector<std::uint32_t>& col : cols) col.clear();
+    }
+};
+
+struct HistoryQuery {
+    std::string name;          // summary, mults, words or first
+    std::uint32_t minScore = 0;
+    std::size_t limit = 20;
+};
+
+// Scans the history file for one of the canned reports. Blocks whose score
+// range lies below q.minScore are skipped unread.
+int queryHistory(const std::string& path, const HistoryQuery& q)
+{
+    HistoryReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Could not read history file " << path << "\n";
+        return 1;
+    }
+
+    const bool filtered = q.name == "mults" || q.name == "words";
+    auto start = std::chrono::steady_clock::now();
+    long long blocks = 0, skipped = 0, damaged = 0, rows = 0, games = 0;
+
+    std::vector<std::uint32_t> game, player, word, tiles, mults, score;
+
+    long long multTiles[5] = {}, multMoves[5] = {};
+    double multScore[5] = {};
+    std::vector<long long> wordCount;
+    std::vector<double> wordScore;
+
+    std::uint32_t curGame = 0;
+    bool inGame = false;
+    long long seatTotals[2] = { 0, 0 };
+    long long firstWins = 0, secondWins = 0, ties = 0;
+    RunningStat firstMargin;
+    auto endGame = [&]() {
+        if (!inGame) return;
+        if (seatTotals[0] > seatTotals[1]) ++firstWins;
+        else if (seatTotals[1] > seatTotals[0]) ++secondWins;
+        else ++ties;
+        firstMargin.add(static_cast<double>(seatTotals[0] - seatTotals[1]));
+        seatTotals[0] = seatTotals[1] = 0;
+        };
+
+    while (reader.next()) {
+        ++blocks;
+        const HistoryBlockHeader& h = reader.header;
+        rows += h.rows;
+        if (h.rows > 0) games = std::max<long long>(games, h.cols[COL_GAME].max + 1);
+        if (filtered && h.cols[COL_SCORE].max < q.minScore) {
+            ++skipped;
+            continue;
+        }
+
+        if (q.name == "mults") {
+            if (!reader.load(COL_TILES, tiles) || !reader.load(COL_MULTS, mults) || !reader.load(COL_SCORE, score)) {
+                ++damaged;
+                continue;
+            }
+            for (std::uint32_t i = 0; i < h.rows; ++i) {
+                if (score[i] < q.minScore) continue;
+                unsigned used = 0;
+                for (std::uint32_t k = 0; k < tiles[i] && k < static_cast<std::uint32_t>(NUM_SPACES); ++k) {
+                    unsigned m = (mults[i] >> (3 * k)) & 7u;
+                    if (m > 4) continue;
+                    ++multTiles[m];
+                    used |= 1u << m;
+                }
+                for (unsigned m = 0; m < 5; ++m) {
+                    if (!(used & (1u << m))) continue;
+                    ++multMoves[m];
+                    multScore[m] += score[i];
+                }
+            }
+        }
+        else if (q.name == "words") {
+            if (!reader.load(COL_WORD, word) || !reader.load(COL_SCORE, score)) {
+                ++damaged;
+                continue;
+            }
+            wordCount.resize(reader.words.size(), 0);
+            wordScore.resize(reader.words.size(), 0.0);
+            for (std::uint32_t i = 0; i < h.rows; ++i) {
+                if (word[i] == 0 || word[i] >= wordCount.size() || score[i] < q.minScore) continue;
+                ++wordCount[word[i]];
+                wordScore[word[i]] += score[i];
+            }
+        }
+        else if (q.name == "first") {
+            if (!reader.load(COL_GAME, game) || !reader.load(COL_PLAYER, player) || !reader.load(COL_SCORE, score)) {
+                ++damaged;
+                continue;
+            }
+            for (std::uint32_t i = 0; i < h.rows; ++i) {
+                if (!inGame || game[i] != curGame) {
+                    endGame();
+                    curGame = game[i];
+                    inGame = true;
+                }
+                seatTotals[player[i] & 1u] += score[i];
+            }
+        }
+    }
+    endGame();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (damaged > 0) {
+        std::cerr << "[WARN] Skipped " << damaged << " damaged block(s) in " << path << "\n";
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (q.name == "mults") {
+        const char* names[5] = { "None", "Double Letter", "Triple Letter", "Double Word", "Triple Word" };
+        out << std::left << std::setw(16) << "Multiplier" << std::right << std::setw(12) << "Tiles"
+            << std::setw(12) << "Moves" << std::setw(16) << "Avg move score" << "\n";
+        for (int m = 0; m < 5; ++m) {
+            out << std::left << std::setw(16) << names[m] << std::right << std::setw(12) << multTiles[m]
+                << std::setw(12) << multMoves[m] << std::setw(16)
+                << (multMoves[m] > 0 ? multScore[m] / static_cast<double>(multMoves[m]) : 0.0) << "\n";
+        }
+    }
+    else if (q.name == "words") {
+        std::vector<std::uint32_t> ids;
+        for (std::uint32_t id = 1; id < wordCount.size(); ++id) {
+            if (wordCount[id] > 0) ids.push_back(id);
+        }
+        std::size_t shown = std::min(q.limit > 0 ? q.limit : ids.size(), ids.size());
+        std::partial_sort(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(shown), ids.end(),
+            [&](std::uint32_t a, std::uint32_t b) {
+                if (wordCount[a] != wordCount[b]) return wordCount[a] > wordCount[b];
+                return reader.words[a] < reader.words[b];
+            });
+        out << std::left << std::setw(12) << "Word" << std::right << std::setw(12) << "Plays"
+            << std::setw(12) << "Avg score" << "\n";
+        for (std::size_t i = 0; i < shown; ++i) {
+            std::uint32_t id = ids[i];
+            out << std::left << std::setw(12) << reader.words[id] << std::right << std::setw(12) << wordCount[id]
+                << std::setw(12) << wordScore[id] / static_cast<double>(wordCount[id]) << "\n";
+        }
+    }
+    else if (q.name == "first") {
+        long long played = firstWins + secondWins + ties;
+        double rate = played > 0 ? 100.0 * (firstWins + 0.5 * ties) / static_cast<double>(played) : 0.0;
+        out << "Games: " << played << "\n"
+            << "First player wins " << firstWins << ", second " << secondWins << ", ties " << ties << "\n"
+            << "First player score rate: " << rate << "%\n"
+            << "First player margin: " << firstMargin.mean << " +/- " << firstMargin.halfWidth(1.96) << "\n";
+    }
+    else if (q.name != "summary") {
+        std::cerr << "Unknown query " << q.name << " (summary, mults, words or first)\n";
+        return 2;
+    }
+
+    std::uintmax_t bytes = 0;
+    std::error_code ec;
+    bytes = std::filesystem::file_size(path, ec);
+    out << games << " games, " << rows << " moves in " << blocks << " blocks (" << skipped
+        << " skipped), " << bytes / 1024 << " KiB on disk, "
+        << (rows > 0 ? static_cast<double>(bytes) / static_cast<double>(rows) : 0.0) << " bytes/move\n"
+        << std::setprecision(3) << "Scanned in " << seconds << " s ("
+        << (seconds > 0.0 ? static_cast<double>(rows) / seconds / 1e6 : 0.0) << " M moves/s)\n";
+    std::cout << out.str();
+    return 0;
+}
+
+// Undo and redo lists, kept together under `budget` bytes by forgetting the
+// oldest undo first. Entries are deltas rather than copies of the game, so
+// even a small budget holds thousands of them.
+template <typename T>
+struct UndoStack {
+    std::deque<T> done;
+    std::deque<T> undone;
+    std::size_t budget;
+    long long forgotten = 0;
+
+    explicit UndoStack(std::size_t budgetBytes)
+        : budget(budgetBytes)
+    {
+    }
+
+    std::size_t bytes() const {
+        return (done.size() + undone.size()) * sizeof(T);
+    }
+
+    // A new action makes everything undone unreachable.
+    void push(const T& action) {
+        undone.clear();
+        done.push_back(action);
+        while (bytes() > budget && done.size() > 1) {
+            done.pop_front();
+            ++forgotten;
+        }
+    }
+
+    // The action to take back, or null when there is none.
+    T* undo() {
+        if (done.empty()) return nullptr;
+        undone.push_back(done.back());
+        done.pop_back();
+        return &undone.back();
+    }
+
+    // The action to play again, or null when there is none.
+    T* redo() {
+        if (undone.empty()) return nullptr;
+        done.push_back(undone.back());
+        undone.pop_back();
+        return &done.back();
+    }
+};
+
+// The row as the player to move has laid it out: which rack tile sits on
+// each space, the multipliers chosen, and the multiplier button held.
+struct RowState {
+    int occupant[NUM_SPACES];
+    Mult mult[NUM_SPACES];
+    int selectedButton;
+
+    RowState()
+        : selectedButton(-1)
+    {
+        std::fill(occupant, occupant + NUM_SPACES, -1);
+        std::fill(mult, mult + NUM_SPACES, Mult::NONE);
+    }
+};
+
+// One undoable step in the window: a tile dropped on the row, or a move
+// committed. Both hold only what they changed.
+struct EditAction {
+    enum class Kind { Drop, Commit };
+    Kind kind = Kind::Drop;
+    int player = 0;
+    RowState before;            // the row before the step
+    RowState after;             // Drop: the row after it
+    int tile = -1;              // Drop: the rack tile moved
+    sf::Vector2f fromPosition;  // Drop: where it was picked up
+    TurnDelta turn;             // Commit: rack and bag changes
+    MoveRecord record;          // Commit: the move as history stores it
+};
+
+static_assert(NUM_SPACES == WB_NUM_SPACES && TILE_KINDS == WB_TILE_KINDS,
+    "word-battle-bot.h must describe the same board and tiles");
+static_assert(static_cast<int>(Mult::TRIPLE_WORD) == WB_MULT_TRIPLE_WORD,
+    "Mult and WB_MULT_* must agree");
+
+const LeaveTable* builtinBotLeaves = nullptr;   // steers the "leave" built-in
+
+void writeBotMove(const Move& m, WbMove* out)
+{
+    *out = WbMove{};
+    std::size_t n = std::min(m.word.size(), static_cast<std::size_t>(WB_NUM_SPACES));
+    std::memcpy(out->word, m.word.data(), n);
+    out->blanks = m.blanks;
+    for (int i = 0; i < WB_NUM_SPACES; ++i) out->mults[i] = static_cast<int32_t>(m.mults[i]);
+}
+
+int32_t greedyBot(const WbGameState* state, WbMove* move)
+{
+    Move best;
+    if (greedyMove(state->rack, best)) writeBotMove(best, move);
+    return 0;
+}
+
+int32_t leaveBot(const WbGameState* state, WbMove* move)
+{
+    Move best;
+    if (greedyMove(state->rack, best, builtinBotLeaves)) writeBotMove(best, move);
+    return 0;
+}
+
+// Name a bot goes by in tables and logs: the built-in's name, or the
+// library's file name without directory or extension.
+std::string botName(const std::string& spec)
+{
+    std::string name = spec.substr(spec.find_last_of("/\\") + 1);
+    return name.substr(0, name.find('.'));
+}
+
+// A player strategy behind chooseMove: "greedy" or "leave" for the built-in
+// bots, otherwise the path of a shared library built against
+// word-battle-bot.h.
+struct BotLibrary {
+    std::string name;
+    WbChooseMoveFn choose = nullptr;
+    void* handle = nullptr;
+
+    BotLibrary() = default;
+    ~BotLibrary() { close(); }
+
+    BotLibrary(const BotLibrary&) = delete;
+    BotLibrary& operator=(const BotLibrary&) = delete;
+
+    bool loaded() const {
+        return choose != nullptr;
+    }
+
+    bool open(const std::string& spec) {
+        close();
+        if (spec == "greedy" || spec == "leave") {
+            name = spec;
+            choose = spec == "greedy" ? greedyBot : leaveBot;
+            return true;
+        }
+
+#ifdef _WIN32
+        HMODULE lib = LoadLibraryA(spec.c_str());
+        if (lib == nullptr) {
+            std::cerr << "[WARN] Could not load bot " << spec << "\n";
+            return false;
+        }
+        auto version = reinterpret_cast<WbAbiVersionFn>(GetProcAddress(lib, "wbAbiVersion"));
+        auto fn = reinterpret_cast<WbChooseMoveFn>(GetProcAddress(lib, "chooseMove"));
+#else
+        void* lib = dlopen(spec.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (lib == nullptr) {
+            std::cerr << "[WARN] Could not load bot " << spec << ": " << dlerror() << "\n";
+            return false;
+        }
+        auto version = reinterpret_cast<WbAbiVersionFn>(dlsym(lib, "wbAbiVersion"));
+        auto fn = reinterpret_cast<WbChooseMoveFn>(dlsym(lib, "chooseMove"));
+#endif
+        if (version == nullptr || fn == nullptr || version() != WB_BOT_ABI_VERSION) {
+            std::cerr << "[WARN] " << spec << " does not export wbAbiVersion and chooseMove for bot ABI "
+                << WB_BOT_ABI_VERSION << "\n";
+#ifdef _WIN32
+            FreeLibrary(lib);
+#else
+            dlclose(lib);
+#endif
+            return false;
+        }
+
+        handle = reinterpret_cast<void*>(lib);
+        choose = fn;
+        name = botName(spec);
+        return true;
+    }
+
+    void close() {
+        if (handle != nullptr) {
+#ifdef _WIN32
+            FreeLibrary(reinterpret_cast<HMODULE>(handle));
+#else
+            dlclose(handle);
+#endif
+        }
+        handle = nullptr;
+        choose = nullptr;
+        name.clear();
+    }
+};
+
+// What pos.toMove may know, in the bot ABI's terms.
+WbGameState botState(const Position& pos, int timeLimitMs, unsigned seed)
+{
+    WbGameState s{};
+    s.abiVersion = WB_BOT_ABI_VERSION;
+    s.seat = pos.toMove;
+    s.movesDone = pos.movesDone;
+    s.maxMoves = MAX_MOVES;
+    s.scores[0] = pos.totals[0];
+    s.scores[1] = pos.totals[1];
+    s.bagSize = static_cast<int32_t>(pos.bag.size());
+    s.timeLimitMs = timeLimitMs;
+
+    const std::string& rack = pos.racks[pos.toMove];
+    std::memcpy(s.rack, rack.data(), std::min(rack.size(), sizeof(s.rack) - 1));
+
+    LetterPool unseen = pos.unseenBy(pos.toMove);
+    for (int k = 0; k < TILE_KINDS; ++k) s.unseen[k] = unseen.counts[k];
+    for (int c = 0; c < 26; ++c) s.letterScores[c] = letterScore(static_cast<char>('A' + c));
+    s.seed = seed;
+    return s;
+}
+
+// Checks a bot's move against its rack and the dictionary and scores it.
+// Returns false for an illegal move; an empty word is a legal pass.
+bool readBotMove(const WbMove& in, const std::string& rack, Move& out)
+{
+    int n = 0;
+    while (n <= NUM_SPACES && in.word[n] != '\0') ++n;
+    if (n > NUM_SPACES || (n < 32 && (in.blanks >> n) != 0)) return false;
+
+    int counts[TILE_KINDS] = {};
+    for (char c : rack) {
+        if (tileIndex(c) >= 0) ++counts[tileIndex(c)];
+    }
+
+    Move m = makeMove("");
+    int letterScores[NUM_SPACES];
+    std::string lower;
+    for (int i = 0; i < n; ++i) {
+        char c = in.word[i];
+        if (c < 'A' || c > 'Z') return false;
+        bool blank = (in.blanks & (1u << i)) != 0;
+        if (counts[blank ? BLANK_KIND : c - 'A']-- <= 0) return false;
+        if (in.mults[i] < WB_MULT_NONE || in.mults[i] > WB_MULT_TRIPLE_WORD) return false;
+
+        m.mults[i] = static_cast<Mult>(in.mults[i]);
+        letterScores[i] = blank ? 0 : letterScore(c);
+        lower += static_cast<char>(c - 'A' + 'a');
+    }
+    if (n > 0 && !dictionaryWords().empty() && dictionaryWords().count(lower) == 0) return false;
+
+    m.word.assign(in.word, in.word + n);
+    m.blanks = in.blanks;
+    m.score = scorePlacement(letterScores, m.mults, n);
+    out = m;
+    return true;
+}
+
+// Plays `move` (an empty word passes) for pos.toMove and refills the rack.
+void playMove(Position& pos, const Move& move)
+{
+    pos.make(move);
+}
+
+struct GameResult {
+    int scores[2] = { 0, 0 };
+    int moves = 0;
+    int illegal[2] = { 0, 0 };   // moves played as a pass because they broke the rules
+    int forfeit = -1;            // seat that lost by crashing or overrunning its time
+    std::string reason;          // "crash" or "timeout" when forfeit >= 0
+    std::vector<MoveRecord> record;
+};
+
+// One game between two bots from a bag shuffled by `seed`. onTurn, when
+// given, sees the position and the tally so far just before each bot is
+// asked for its move. A move that comes back after moveMs (0 for no limit)
+// forfeits the game.
+GameResult playBotGame(
+    const BotLibrary& first,
+    const BotLibrary& second,
+    unsigned seed,
+    int moveMs,
+    const std::function<void(const Position&, const GameResult&)>& onTurn = {}
+) {
+    const BotLibrary* seats[2] = { &first, &second };
+
+    Position pos;
+    pos.bag = TileBag(seed);
+    for (int pl = 0; pl < 2; ++pl) {
+        while (static_cast<int>(pos.racks[pl].size()) < RACK_SIZE && !pos.bag.empty()) {
+            pos.racks[pl] += pos.bag.draw();
+        }
+    }
+
+    std::mt19937 rng(seed);
+    GameResult res;
+    while (pos.movesDone < MAX_MOVES) {
+        const int seat = pos.toMove;
+        WbGameState state = botState(pos, moveMs, rng());
+        WbMove choice{};
+        if (onTurn) onTurn(pos, res);
+
+        auto start = std::chrono::steady_clock::now();
+        int32_t rc = seats[seat]->choose(&state, &choice);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (moveMs > 0 && ms > moveMs) {
+            res.forfeit = seat;
+            res.reason = "timeout";
+            break;
+        }
+
+        Move move = makeMove("");
+        if (rc == 0 && !readBotMove(choice, pos.racks[seat], move)) ++res.illegal[seat];
+        res.record.push_back({ seat, move, static_cast<int>(pos.bag.size()) });
+        playMove(pos, move);
+    }
+
+    res.scores[0] = pos.totals[0];
+    res.scores[1] = pos.totals[1];
+    res.moves = pos.movesDone;
+    return res;
+}
+
+// ---- Tournaments ----
+
+struct TournamentConfig {
+    std::vector<std::string> bots;   // built-in names or library paths
+    bool swiss = false;              // else round robin
+    int rounds = 0;                  // Swiss rounds, 0 for ceil(log2(bots))
+    int games = 2;                   // per pairing, seats alternating
+    int moveMs = 1000;               // per move, 0 for no limit
+    int workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));   // games at once
+    unsigned seed = 0;               // 0 = seed from std::random_device
+};
+
+struct GameJob {
+    int bots[2];       // indices into TournamentConfig::bots, by seat
+    unsigned seed;
+};
+
+struct Standing {
+    std::string name;
+    double elo = 1500.0;
+    double points = 0.0;
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+    int crashes = 0;
+    int timeouts = 0;
+    int illegal = 0;
+    bool hadBye = false;
+    RunningStat margin;   // own score minus the opponent's, per game
+};
+
+#ifndef _WIN32
+void writeLine(int fd, const std::string& line)
+{
+    std::string s = line + "\n";
+    const char* p = s.data();
+    std::size_t left = s.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n <= 0) return;
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+}
+
+// Body of a forked game worker: loads both bots into this process, plays
+// the game and reports over `fd`, one line per turn and a final result.
+int runGameWorker(const TournamentConfig& cfg, const GameJob& job, int fd)
+{
+    // A bot that dies while loading forfeits as the seat named here.
+    BotLibrary bots[2];
+    for (int seat = 0; seat < 2; ++seat) {
+        writeLine(fd, "load " + std::to_string(seat));
+        if (!bots[seat].open(cfg.bots[job.bots[seat]])) return 3;
+    }
+
+    auto turn = [&](const Position& pos, const GameResult& sofar) {
+        writeLine(fd, "turn " + std::to_string(pos.toMove) + " " + std::to_string(pos.totals[0]) + " " +
+            std::to_string(pos.totals[1]) + " " + std::to_string(pos.movesDone) + " " +
+            std::to_string(sofar.illegal[0]) + " " + std::to_string(sofar.illegal[1]));
+        };
+    GameResult res = playBotGame(bots[0], bots[1], job.seed, cfg.moveMs, turn);
+
+    for (const MoveRecord& r : res.record) {
+        unsigned mults = 0;
+        for (int k = 0; k < NUM_SPACES; ++k) mults |= static_cast<unsigned>(r.move.mults[k]) << (3 * k);
+        writeLine(fd, "move " + std::to_string(r.player) + " " + (r.move.word.empty() ? "-" : r.move.word) + " " +
+            std::to_string(r.move.blanks) + " " + std::to_string(mults) + " " +
+            std::to_string(r.move.score) + " " + std::to_string(r.bagSize));
+    }
+
+    writeLine(fd, "done " + std::to_string(res.scores[0]) + " " + std::to_string(res.scores[1]) + " " +
+        std::to_string(res.moves) + " " + std::to_string(res.illegal[0]) + " " +
+        std::to_string(res.illegal[1]) + " " + std::to_string(res.forfeit) + " " +
+        (res.reason.empty() ? "-" : res.reason));
+    std::cout.flush();
+    return 0;
+}
+#endif
+
+// Loads `spec` in a child process to check it speaks the bot ABI, so a
+// library that crashes while loading cannot take the tournament down with
+// it. Returns 0 when it loads, 1 when it is refused and 2 when it crashed.
+int probeBot(const std::string& spec)
+{
+    if (spec == "greedy" || spec == "leave") return 0;
+#ifdef _WIN32
+    BotLibrary probe;
+    return probe.open(spec) ? 0 : 1;
+#else
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        BotLibrary probe;
+        _exit(probe.open(spec) ? 0 : 1);
+    }
+    if (pid < 0) {
+        std::cerr << "[WARN] fork failed: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status)) return WEXITSTATUS(status) == 0 ? 0 : 1;
+    return 2;
+#endif
+}
+
+// Plays every job, up to cfg.workers at a time, and hands each result to
+// onDone as it finishes. Every game runs in a forked process that loads its
+// own copy of the bots: a bot that crashes only takes its own game down and
+// forfeits it, and one still thinking past its move limit is killed and
+// forfeits too. Windows has no fork, so there the games run one after
+// another in this process and time limits are only checked once a move
+// comes back.
+void runGames(
+    const TournamentConfig& cfg,
+    const std::vector<GameJob>& jobs,
+    const std::function<void(const GameJob&, const GameResult&)>& onDone
+) {
+#ifdef _WIN32
+    for (const GameJob& job : jobs) {
+        // A bot that fails to load forfeits, as a crashed worker would.
+        BotLibrary bots[2];
+        GameResult res;
+        for (int seat = 0; seat < 2 && res.forfeit < 0; ++seat) {
+            if (bots[seat].open(cfg.bots[job.bots[seat]])) continue;
+            std::cerr << "[WARN] " << botName(cfg.bots[job.bots[seat]]) << " failed to load; it forfeits the game\n";
+            res.forfeit = seat;
+            res.reason = "crash";
+        }
+        if (res.forfeit < 0) res = playBotGame(bots[0], bots[1], job.seed, cfg.moveMs);
+        onDone(job, res);
+    }
+#else
+    // Allowance past the move limit for process scheduling and the pipe.
+    const int graceMs = 250;
+
+    struct Worker {
+        pid_t pid;
+        int fd;
+        std::size_t job;
+        std::string pending;
+        int onMove;                                    // seat thinking, -1 before the first turn
+        int due;                                       // seat loading or to move; forfeits a crash
+        std::chrono::steady_clock::time_point moveStart;
+        bool finished;
+        GameResult res;
+    };
+    std::vector<Worker> workers;
+    std::size_t next = 0;
+
+    while (next < jobs.size() || !workers.empty()) {
+        while (next < jobs.size() && static_cast<int>(workers.size()) < std::max(1, cfg.workers)) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+                std::cerr << "[WARN] pipe failed: " << std::strerror(errno) << "\n";
+                break;
+            }
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid == 0) {
+                ::close(fds[0]);
+                _exit(runGameWorker(cfg, jobs[next], fds[1]));
+            }
+            ::close(fds[1]);
+            if (pid < 0) {
+                std::cerr << "[WARN] fork failed: " << std::strerror(errno) << "\n";
+                ::close(fds[0]);
+                break;
+            }
+            workers.push_back({ pid, fds[0], next, "", -1, 0, std::chrono::steady_clock::now(), false, GameResult() });
+            ++next;
+        }
+        if (workers.empty()) break;
+
+        auto now = std::chrono::steady_clock::now();
+        int waitMs = 1000;
+        std::vector<pollfd> pfds;
+        for (const Worker& w : workers) {
+            pfds.push_back({ w.fd, POLLIN, 0 });
+            if (w.onMove >= 0 && cfg.moveMs > 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    w.moveStart + std::chrono::milliseconds(cfg.moveMs + graceMs) - now).count();
+                waitMs = std::min(waitMs, static_cast<int>(std::max<long long>(0, left)) + 1);
+            }
+        }
+        poll(pfds.data(), pfds.size(), waitMs);
+        now = std::chrono::steady_clock::now();
+
+        for (std::size_t i = workers.size(); i-- > 0;) {
+            Worker& w = workers[i];
+            bool closed = false;
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                char buf[512];
+                ssize_t n = ::read(w.fd, buf, sizeof(buf));
+                if (n > 0) w.pending.append(buf, static_cast<std::size_t>(n));
+                else closed = true;
+
+                std::size_t eol;
+                while ((eol = w.pending.find('\n')) != std::string::npos) {
+                    std::istringstream line(w.pending.substr(0, eol));
+                    w.pending.erase(0, eol + 1);
+                    std::string kind;
+                    line >> kind;
+                    if (kind == "load") {
+                        line >> w.due;
+                    }
+                    else if (kind == "turn") {
+                        line >> w.onMove >> w.res.scores[0] >> w.res.scores[1] >> w.res.moves
+                            >> w.res.illegal[0] >> w.res.illegal[1];
+                        w.due = w.onMove;
+                        w.moveStart = now;
+                    }
+                    else if (kind == "move") {
+                        MoveRecord r{ 0, makeMove(""), 0 };
+                        unsigned mults = 0;
+                        line >> r.player >> r.move.word >> r.move.blanks >> mults >> r.move.score >> r.bagSize;
+                        if (r.move.word == "-") r.move.word.clear();
+                        for (int k = 0; k < NUM_SPACES; ++k) r.move.mults[k] = static_cast<Mult>((mults >> (3 * k)) & 7u);
+                        w.res.record.push_back(r);
+                    }
+                    else if (kind == "done") {
+                        line >> w.res.scores[0] >> w.res.scores[1] >> w.res.moves >> w.res.illegal[0]
+                            >> w.res.illegal[1] >> w.res.forfeit >> w.res.reason;
+                        if (w.res.reason == "-") w.res.reason.clear();
+                        w.finished = true;
+                    }
+                }
+            }
+
+            if (!closed && !w.finished && w.onMove >= 0 && cfg.moveMs > 0 &&
+                now - w.moveStart > std::chrono::milliseconds(cfg.moveMs + graceMs))
+            {
+                kill(w.pid, SIGKILL);
+                w.res.forfeit = w.onMove;
+                w.res.reason = "timeout";
+                w.finished = true;
+                closed = true;
+            }
+            if (!closed) continue;
+
+            ::close(w.fd);
+            int status = 0;
+            waitpid(w.pid, &status, 0);
+            if (!w.finished) {
+                w.res.forfeit = w.due;
+                w.res.reason = "crash";
+                w.finished = true;
+            }
+            onDone(jobs[w.job], w.res);
+            workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+#endif
+}
+
+// Elo (K = 16), points, score margins and faults for one finished game.
+void recordGame(std::vector<Standing>& table, const GameJob& job, const GameResult& res)
+{
+    Standing& a = table[job.bots[0]];
+    Standing& b = table[job.bots[1]];
+
+    double scoreA;
+    if (res.forfeit >= 0) scoreA = res.forfeit == 0 ? 0.0 : 1.0;
+    else if (res.scores[0] != res.scores[1]) scoreA = res.scores[0] > res.scores[1] ? 1.0 : 0.0;
+    else scoreA = 0.5;
+
+    const double k = 16.0;
+    double expectA = 1.0 / (1.0 + std::pow(10.0, (b.elo - a.elo) / 400.0));
+    a.elo += k * (scoreA - expectA);
+    b.elo -= k * (scoreA - expectA);
+
+    a.points += scoreA;
+    b.points += 1.0 - scoreA;
+    if (scoreA == 1.0) { ++a.wins; ++b.losses; }
+    else if (scoreA == 0.0) { ++a.losses; ++b.wins; }
+    else { ++a.draws; ++b.draws; }
+
+    a.margin.add(res.scores[0] - res.scores[1]);
+    b.margin.add(res.scores[1] - res.scores[0]);
+    a.illegal += res.illegal[0];
+    b.illegal += res.illegal[1];
+    if (res.forfeit >= 0) {
+        Standing& loser = table[job.bots[res.forfeit]];
+        if (res.reason == "timeout") ++loser.timeouts;
+        else ++loser.crashes;
+    }
+}
+
+void printStandings(std::ostream& out, std::vector<Standing> table)
+{
+    std::sort(table.begin(), table.end(), [](const Standing& x, const Standing& y) {
+        return x.elo > y.elo;
+        });
+
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1);
+    s << std::left << std::setw(16) << "Bot" << std::right
+        << std::setw(8) << "Elo" << std::setw(7) << "Games" << std::setw(5) << "W"
+        << std::setw(5) << "D" << std::setw(5) << "L" << std::setw(8) << "Points"
+        << std::setw(24) << "Margin (95%)" << std::setw(7) << "Crash"
+        << std::setw(9) << "Timeout" << std::setw(9) << "Illegal" << "\n";
+    for (const Standing& st : table) {
+        std::ostringstream margin;
+        margin << std::fixed << std::setprecision(1) << std::showpos << st.margin.mean
+            << std::noshowpos << " +/- " << st.margin.halfWidth(1.96);
+        s << std::left << std::setw(16) << st.name << std::right
+            << std::setw(8) << st.elo << std::setw(7) << st.margin.n << std::setw(5) << st.wins
+            << std::setw(5) << st.draws << std::setw(5) << st.losses << std::setw(8) << st.points
+            << std::setw(24) << margin.str() << std::setw(7) << st.crashes
+            << std::setw(9) << st.timeouts << std::setw(9) << st.illegal << "\n";
+    }
+    out << s.str();
+}
+
+// Round robin: every pair meets cfg.games times. Swiss: each round pairs
+// bots on equal points that have not met yet, the odd one out taking a bye
+// worth a win. Paired games share a bag with seats swapped, so the luck of
+// the draw evens out. Games that end without a forfeit go to `history`
+// when one is given.
+int runTournament(const TournamentConfig& cfg, HistoryWriter* history = nullptr)
+{
+    const int n = static_cast<int>(cfg.bots.size());
+    if (n < 2) {
+        std::cerr << "A tournament needs at least two bots.\n";
+        return 2;
+    }
+
+    std::vector<Standing> table(n);
+    for (int i = 0; i < n; ++i) {
+        int probe = probeBot(cfg.bots[i]);
+        if (probe == 1) return 1;
+        if (probe == 2) {
+            std::cerr << "[WARN] " << cfg.bots[i] << " crashed while loading; it forfeits its games.\n";
+        }
+        table[i].name = botName(cfg.bots[i]);
+    }
+
+    // Built once here so forked workers share them instead of each reading
+    // the word list again.
+    dictionaryWords();
+    anagramIndex();
+    lexicon();
+
+    std::mt19937 seeds(cfg.seed ? cfg.seed : std::random_device{}());
+    auto pairGames = [&](int a, int b, std::vector<GameJob>& jobs) {
+        unsigned seed = 0;
+        for (int g = 0; g < cfg.games; ++g) {
+            if (g % 2 == 0) seed = seeds();
+            jobs.push_back(g % 2 == 0 ? GameJob{ { a, b }, seed } : GameJob{ { b, a }, seed });
+        }
+        };
+
+    auto start = std::chrono::steady_clock::now();
+    long long played = 0;
+    auto onDone = [&](const GameJob& job, const GameResult& res) {
+        recordGame(table, job, res);
+        if (history != nullptr && res.forfeit < 0) history->addGame(res.record);
+        ++played;
+        if (res.forfeit >= 0) {
+            std::cout << table[job.bots[res.forfeit]].name << " forfeits a game to "
+                << table[job.bots[1 - res.forfeit]].name << " (" << res.reason << ")\n";
+        }
+        };
+
+    if (!cfg.swiss) {
+        std::vector<GameJob> jobs;
+        for (int a = 0; a < n; ++a) {
+            for (int b = a + 1; b < n; ++b) pairGames(a, b, jobs);
+        }
+        std::cout << "Round robin: " << n << " bots, " << jobs.size() << " games\n";
+        runGames(cfg, jobs, onDone);
+    }
+    else {
+        int rounds = cfg.rounds;
+        if (rounds <= 0) rounds = std::max(1, static_cast<int>(std::ceil(std::log2(n))));
+        std::vector<std::vector<char>> met(n, std::vector<char>(n, 0));
+
+        for (int round = 1; round <= rounds; ++round) {
+            std::vector<int> order(n);
+            for (int i = 0; i < n; ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](int x, int y) {
+                if (table[x].points != table[y].points) return table[x].points > table[y].points;
+                return table[x].elo > table[y].elo;
+                });
+
+            if (n % 2 == 1) {
+                auto bye = std::find_if(order.rbegin(), order.rend(), [&](int i) { return !table[i].hadBye; });
+                int who = bye != order.rend() ? *bye : order.back();
+                table[who].hadBye = true;
+                table[who].points += 1.0;
+                order.erase(std::find(order.begin(), order.end(), who));
+                std::cout << "Round " << round << ": bye for " << table[who].name << "\n";
+            }
+
+            std::vector<GameJob> jobs;
+            while (!order.empty()) {
+                int a = order.front();
+                auto opp = std::find_if(order.begin() + 1, order.end(), [&](int b) { return !met[a][b]; });
+                if (opp == order.end()) opp = order.begin() + 1;
+                int b = *opp;
+                met[a][b] = met[b][a] = 1;
+                order.erase(opp);
+                order.erase(order.begin());
+                pairGames(a, b, jobs);
+            }
+            std::cout << "Round " << round << " of " << rounds << ": " << jobs.size() << " games\n";
+            runGames(cfg, jobs, onDone);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\n";
+    printStandings(std::cout, table);
+    std::cout << played << " games in " << seconds << " s ("
+        << (seconds > 0.0 ? played * 3600.0 / seconds : 0.0) << " matches/hour, "
+        << std::max(1, cfg.workers) << " worker(s))\n";
+    return 0;
+}
+
+// Scores a million random placements with scoreBatch() and with
+// scorePlacement(), checks every score agrees and reports the throughput of
+// both.
+int benchScoring()
+{
+#if defined(__AVX2__)
+    const char* path = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const char* path = "SSE2";
+#else
+    const char* path = "scalar";
+#endif
+    const int n = 1 << 20;
+    const int reps = 20;
+    std::mt19937 rng(1);
+    std::vector<int> letters(static_cast<std::size_t>(n) * NUM_SPACES);
+    std::vector<Mult> mults(static_cast<std::size_t>(n) * NUM_SPACES);
+    std::vector<int> counts(n);
+    long long tiles = 0;
+    for (int c = 0; c < n; ++c) {
+        counts[c] = 1 + static_cast<int>(rng() % NUM_SPACES);
+        tiles += counts[c];
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            letters[c * NUM_SPACES + i] = static_cast<int>(rng() % 11);
+            mults[c * NUM_SPACES + i] = static_cast<Mult>(rng() % 5);
+        }
+    }
+
+    ScoreArena arena;
+    auto start = std::chrono::steady_clock::now();
+    ScoreBatch batch(arena, n);
+    for (int c = 0; c < n; ++c) batch.add(&letters[c * NUM_SPACES], &mults[c * NUM_SPACES], counts[c]);
+    double fillSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) scoreBatch(batch);
+    double batchSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+
+    std::vector<int> expected(n);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) {
+        for (int c = 0; c < n; ++c) {
+            expected[c] = scorePlacement(&letters[c * NUM_SPACES], &mults[c * NUM_SPACES], counts[c]);
+        }
+    }
+    double scalarSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+
+    int mismatches = 0;
+    for (int c = 0; c < n; ++c) {
+        if (batch.scores[c] != expected[c]) ++mismatches;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "scoreBatch (" << path << "): " << tiles / batchSec / 1e6 << " M tile-scores/s, "
+        << n / batchSec / 1e6 << " M placements/s (filling the batch: "
+        << n / fillSec / 1e6 << " M placements/s)\n"
+        << "scorePlacement: " << tiles / scalarSec / 1e6 << " M tile-scores/s, "
+        << n / scalarSec / 1e6 << " M placements/s\n"
+        << (mismatches == 0 ? "All " : "MISMATCH: ") << (mismatches == 0 ? n : mismatches)
+        << " scores " << (mismatches == 0 ? "agree" : "differ") << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Positions from greedy self-play, each saved and restored two ways: by
+// copying the whole Position, and by make()/unmake() deltas. Checks the
+// deltas restore every position exactly and reports both costs.
+int benchUndo()
+{
+    const int games = 50;
+    std::vector<Position> positions;
+    std::vector<Move> moves;
+    for (int g = 0; g < games; ++g) {
+        Position pos;
+        pos.bag = TileBag(static_cast<unsigned>(g + 1));
+        for (int pl = 0; pl < 2; ++pl) {
+            while (static_cast<int>(pos.racks[pl].size()) < RACK_SIZE && !pos.bag.empty()) {
+                pos.racks[pl] += pos.bag.draw();
+            }
+        }
+        while (pos.movesDone < MAX_MOVES) {
+            Move move = makeMove("");
+            greedyMove(pos.racks[pos.toMove], move);
+            positions.push_back(pos);
+            moves.push_back(move);
+            pos.make(move);
+        }
+    }
+    const std::size_t n = positions.size();
+
+    auto same = [](const Position& a, const Position& b) {
+        return a.racks[0] == b.racks[0] && a.racks[1] == b.racks[1] &&
+            a.bag.order == b.bag.order &&
+            std::equal(a.bag.pool.tree, a.bag.pool.tree + TILE_KINDS + 1, b.bag.pool.tree) &&
+            a.totals[0] == b.totals[0] && a.totals[1] == b.totals[1] &&
+            a.toMove == b.toMove && a.movesDone == b.movesDone;
+        };
+    int mismatches = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        Position p = positions[i];
+        p.unmake(p.make(moves[i]));
+        if (!same(p, positions[i])) ++mismatches;
+    }
+
+    const int reps = 2000;
+    std::vector<Position> work = positions;
+    std::vector<Position> copies(n);
+    std::vector<TurnDelta> deltas(n);
+    double freshSec = 0.0, copySec = 0.0, copyBackSec = 0.0, makeSec = 0.0, unmakeSec = 0.0;
+    std::vector<Position> nodes;
+    nodes.reserve(n);
+    for (int r = 0; r < reps; ++r) {
+        // A search node that copies its parent pays for a fresh Position.
+        auto tf = std::chrono::steady_clock::now();
+        nodes.clear();
+        for (std::size_t i = 0; i < n; ++i) nodes.push_back(work[i]);
+        auto t0 = std::chrono::steady_clock::now();
+        freshSec += std::chrono::duration<double>(t0 - tf).count();
+        for (std::size_t i = 0; i < n; ++i) copies[i] = work[i];
+        auto t1 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) work[i] = copies[i];
+        auto t2 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) deltas[i] = work[i].make(moves[i]);
+        auto t3 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) work[i].unmake(deltas[i]);
+        auto t4 = std::chrono::steady_clock::now();
+        copySec += std::chrono::duration<double>(t1 - t0).count();
+        copyBackSec += std::chrono::duration<double>(t2 - t1).count();
+        makeSec += std::chrono::duration<double>(t3 - t2).count();
+        unmakeSec += std::chrono::duration<double>(t4 - t3).count();
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!same(work[i], positions[i])) ++mismatches;
+    }
+
+    std::size_t copyBytes = 0;
+    for (const Position& p : positions) {
+        copyBytes += sizeof(Position) + p.bag.order.size() + p.racks[0].size() + p.racks[1].size();
+    }
+    const double ops = static_cast<double>(n) * reps;
+    std::cout << std::fixed << std::setprecision(1)
+        << n << " positions from " << games << " games, " << reps << " rounds each\n"
+        << "Full copy:    snapshot " << freshSec / ops * 1e9 << " ns into a new Position, "
+        << copySec / ops * 1e9 << " ns over a reused one, restore " << copyBackSec / ops * 1e9
+        << " ns, " << copyBytes / n << " bytes\n"
+        << "make/unmake:  snapshot " << makeSec / ops * 1e9 << " ns (playing the move included), restore "
+        << unmakeSec / ops * 1e9 << " ns, " << sizeof(TurnDelta) << " bytes\n"
+        << "Undo history: " << sizeof(EditAction) << " bytes per edit, "
+        << (1 << 20) / sizeof(EditAction) << " edits in 1 MiB\n"
+        << (mismatches == 0 ? "Every position restored exactly\n" : "MISMATCH: positions differ after unmake\n");
+    std::cout.unsetf(std::ios::floatfield);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Writes games to a scratch history file, cuts its last block short the way
+// a crash mid-append would, reopens the file and appends more games, then
+// reads everything back and checks every move decodes to the word it was
+// written with.
+int checkHistory()
+{
+    std::error_code ec;
+    const std::filesystem::path file = std::filesystem::temp_directory_path(ec) / "word-battle-check.wbh";
+    std::filesystem::remove(file, ec);
+
+    std::mt19937 rng(1);
+    auto randomGame = [&]() {
+        std::vector<MoveRecord> game;
+        for (int i = 0; i < 12; ++i) {
+            std::string word;
+            int length = 2 + static_cast<int>(rng() % (NUM_SPACES - 1));
+            for (int k = 0; k < length; ++k) word += static_cast<char>('A' + rng() % 26);
+            game.push_back({ i & 1, makeMove(i % 5 == 4 ? "" : word), 60 - i });
+        }
+        return game;
+        };
+
+    // Game ids count up from 0, so kept[g] is what game g should hold.
+    std::vector<std::vector<MoveRecord>> kept;
+    {
+        HistoryWriter writer;
+        if (!writer.open(file.string())) return 1;
+        for (int g = 0; g < 20; ++g) {
+            kept.push_back(randomGame());
+            writer.addGame(kept.back());
+        }
+        writer.flush();
+        for (int g = 0; g < 20; ++g) writer.addGame(randomGame());
+    }
+    std::filesystem::resize_file(file, std::filesystem::file_size(file, ec) - 8, ec);
+    {
+        HistoryWriter writer;
+        if (!writer.open(file.string())) return 1;
+        for (int g = 0; g < 20; ++g) {
+            kept.push_back(randomGame());
+            writer.addGame(kept.back());
+        }
+    }
+
+    HistoryReader reader;
+    if (!reader.open(file.string())) return 1;
+    std::vector<std::uint32_t> game, move, word;
+    std::size_t rows = 0, expected = 0, mismatches = 0;
+    for (const std::vector<MoveRecord>& g : kept) expected += g.size();
+    while (reader.next()) {
+        if (!reader.load(COL_GAME, game) || !reader.load(COL_MOVE, move) || !reader.load(COL_WORD, word)) {
+            mismatches += reader.header.rows;
+            continue;
+        }
+        for (std::uint32_t i = 0; i < reader.header.rows; ++i) {
+            ++rows;
+            if (game[i] >= kept.size() || move[i] >= kept[game[i]].size() ||
+                reader.words[word[i]] != kept[game[i]][move[i]].move.word)
+            {
+                ++mismatches;
+            }
+        }
+    }
+    reader.in.close();
+    if (rows != expected) ++mismatches;
+
+    HistoryQuery q;
+    q.name = "words";
+    q.limit = 5;
+    int rc = queryHistory(file.string(), q);
+    std::filesystem::remove(file, ec);
+
+    std::cout << rows << " moves read back after dropping a cut-off block, " << expected << " expected\n"
+        << (mismatches == 0 ? "Every move decodes to the word it was written with\n"
+            : "MISMATCH: moves decode to the wrong words\n");
+    return mismatches == 0 && rc == 0 ? 0 : 1;
+}
+
+// Prints each length bucket's counts and most common letters, then deals
+// racks from shuffled bags and finds their words both by scanning the
+// buckets up to NUM_SPACES letters and by walking the trie, checking the two
+// agree.
+int lexiconStats(unsigned seed)
+{
+    const Lexicon& lex = lexicon();
+    if (lex.wordCount == 0) {
+        std::cerr << "No dictionary loaded\n";
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(6) << "Len" << std::right << std::setw(10) << "Words"
+        << std::setw(10) << "KiB" << "  Letters (share of words using them)\n";
+    std::cout << std::fixed << std::setprecision(0);
+    std::size_t scanned = 0;
+    for (int len = 1; len <= Lexicon::MAX_WORD; ++len) {
+        const Lexicon::BucketStats& s = lex.stats[len];
+        if (s.words == 0) continue;
+        if (len <= NUM_SPACES) scanned += s.words;
+
+        int order[26];
+        for (int c = 0; c < 26; ++c) order[c] = c;
+        std::sort(order, order + 26, [&](int a, int b) { return s.containing[a] > s.containing[b]; });
+        std::size_t bytes = lex.buckets[len].size() + lex.masks[len].size() * sizeof(std::uint32_t);
+        std::cout << std::left << std::setw(6) << len << std::right << std::setw(10) << s.words
+            << std::setw(10) << bytes / 1024.0 << " ";
+        for (int k = 0; k < 6; ++k) {
+            std::cout << " " << static_cast<char>('A' + order[k]) << " "
+                << 100.0 * static_cast<double>(s.containing[order[k]]) / static_cast<double>(s.words) << "%";
+        }
+        std::cout << "\n";
+    }
+
+    const int racks = 2000;
+    std::vector<std::string> dealt;
+    for (int r = 0; r < racks; ++r) {
+        TileBag bag(seed + static_cast<unsigned>(r));
+        std::string rack;
+        while (static_cast<int>(rack.size()) < RACK_SIZE && !bag.empty()) rack += bag.draw();
+        dealt.push_back(rack);
+    }
+
+    // Timed with a callback that only counts, so the searches are measured
+    // rather than whatever is done with their words.
+    std::size_t words = 0;
+    std::size_t walked = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < racks; ++r) {
+        lex.scanRack(dealt[r], NUM_SPACES, [&](const std::string&, unsigned) { ++words; });
+    }
+    double scanUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / racks;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < racks; ++r) {
+        lex.forEachRackWord(dealt[r], NUM_SPACES, [&](const std::string&, unsigned) { ++walked; });
+    }
+    double trieUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / racks;
+
+    typedef std::vector<std::pair<std::string, unsigned>> Found;
+    int mismatches = words == walked ? 0 : 1;
+    for (int r = 0; r < racks; ++r) {
+        Found byScan, byTrie;
+        lex.scanRack(dealt[r], NUM_SPACES, [&](const std::string& w, unsigned blanks) {
+            byScan.push_back({ w, blanks });
+            });
+        lex.forEachRackWord(dealt[r], NUM_SPACES, [&](const std::string& w, unsigned blanks) {
+            byTrie.push_back({ w, blanks });
+            });
+        std::sort(byScan.begin(), byScan.end());
+        std::sort(byTrie.begin(), byTrie.end());
+        if (byScan != byTrie) ++mismatches;
+    }
+
+    std::cout << std::setprecision(1)
+        << lex.wordCount << " words in all, " << scanned << " of up to " << NUM_SPACES << " letters\n"
+        << racks << " racks, " << static_cast<double>(words) / racks << " words each: mask scan "
+        << scanUs << " us/rack, trie walk " << trieUs << " us/rack\n"
+        << (mismatches == 0 ? "Both find the same words\n" : "MISMATCH: the scan and the walk disagree\n");
+    std::cout.unsetf(std::ios::floatfield);
+    return mismatches == 0 ? 0 : 1;
+}
+
+struct Options {
+    std::string leavesPath = "leaves.bin";
+    bool leavesPathGiven = false;
+    std::string buildLeaves;   // --build-leaves output path
+    int samples = 64;
+    unsigned seed = 0;         // 0 = seed from std::random_device
+    std::string pattern;       // --pattern query
+    std::string rack;          // --rack tiles for --pattern
+    bool rackGiven = false;
+    int limit = 50;
+    std::string seatBots[2];   // --bot0/--bot1, empty for a human
+    TournamentConfig tournament;
+    bool tournamentGiven = false;
+    std::string historyPath = "history.wbh";   // empty with --no-history
+    HistoryQuery query;                         // --query, run against historyPath
+    bool benchScoring = false;
+    bool benchUndo = false;
+    bool checkHistory = false;
+    bool lexiconStats = false;
+    std::string containing;    // --containing letters
+    int length = 0;            // --length for --containing, 0 for any
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: word-battle [options]\n"
+        "  --dict PATH            word list (default " << dictionaryPath << ")\n"
+        "  --leaves PATH          leave table to load (default leaves.bin)\n"
+        "  --seed N               seed for the bag and simulations\n"
+        "  --build-leaves PATH    simulate and write a leave table, then exit\n"
+        "  --samples N            simulated turns per leave for --build-leaves (default 64)\n"
+        "  --pattern PAT          list words matching PAT ('?' one letter, '*' any run), then exit\n"
+        "  --rack TILES           fill --pattern wildcards from these tiles ('?' is a blank)\n"
+        "  --limit N              most matches --pattern prints (default 50, 0 for all)\n"
+        "  --containing LETTERS   list words using all of LETTERS, then exit\n"
+        "  --length N             only words of N letters for --containing\n"
+        "  --lexicon-stats        print word counts and letter shares per length, then exit\n"
+        "  --bot0 BOT, --bot1 BOT let a bot play that seat: greedy, leave or a library path\n"
+        "  --tournament A,B,...   play the listed bots against each other, then exit\n"
+        "  --swiss                Swiss pairings instead of round robin\n"
+        "  --rounds N             Swiss rounds (default enough to separate the field)\n"
+        "  --games N              games per pairing, seats alternating (default 2)\n"
+        "  --move-ms N            per-move time limit in tournaments (default 1000, 0 for none)\n"
+        "  --workers N            tournament games played at once (default one per core)\n"
+        "  --history PATH         append finished games here (default history.wbh)\n"
+        "  --no-history           do not record games\n"
+        "  --query NAME           report from the history, then exit: summary, mults (average\n"
+        "                         move score by multiplier), words (most played) or first\n"
+        "                         (first-player advantage); --limit caps the word list\n"
+        "  --min-score N          only count moves scoring at least N in mults and words\n"
+        "  --bench-scoring        check and time the batch scoring kernel, then exit\n"
+        "  --bench-undo           time position snapshots by copy and by make/unmake, then exit\n"
+        "  --check-history        check a history file survives a cut-off block, then exit\n";
+}
+
+// Reads the whole of `text` as a number that fits in `out`. On bad input
+// it reports `arg`, prints the usage and returns false.
+template <typename T>
+bool parseNumber(const std::string& arg, const char* text, T& out)
+{
+    try {
+        std::size_t used = 0;
+        long long v = std::stoll(text, &used);
+        if (used == std::strlen(text) &&
+            v >= static_cast<long long>(std::numeric_limits<T>::min()) &&
+            v <= static_cast<long long>(std::numeric_limits<T>::max()))
+        {
+            out = static_cast<T>(v);
+            return true;
+        }
+    }
+    catch (const std::exception&) {
+    }
+    std::cerr << "Not a valid number for " << arg << ": " << text << "\n";
+    printUsage();
+    return false;
+}
+
+bool parseOptions(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--dict" && hasValue) {
+            dictionaryPath = argv[++i];
+        }
+        else if (arg == "--leaves" && hasValue) {
+            opts.leavesPath = argv[++i];
+            opts.leavesPathGiven = true;
+        }
+        else if (arg == "--seed" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.seed)) return false;
+        }
+        else if (arg == "--build-leaves" && hasValue) {
+            opts.buildLeaves = argv[++i];
+        }
+        else if (arg == "--samples" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.samples)) return false;
+            opts.samples = std::max(1, opts.samples);
+        }
+        else if (arg == "--pattern" && hasValue) {
+            opts.pattern = argv[++i];
+        }
+        else if (arg == "--rack" && hasValue) {
+            opts.rack = argv[++i];
+            opts.rackGiven = true;
+        }
+        else if (arg == "--limit" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.limit)) return false;
+            opts.limit = std::max(0, opts.limit);
+        }
+        else if ((arg == "--bot0" || arg == "--bot1") && hasValue) {
+            opts.seatBots[arg == "--bot1" ? 1 : 0] = argv[++i];
+        }
+        else if (arg == "--tournament" && hasValue) {
+            std::stringstream list(argv[++i]);
+            std::string bot;
+            while (std::getline(list, bot, ',')) {
+                if (!bot.empty()) opts.tournament.bots.push_back(bot);
+            }
+            opts.tournamentGiven = true;
+        }
+        else if (arg == "--swiss") {
+            opts.tournament.swiss = true;
+        }
+        else if (arg == "--rounds" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.tournament.rounds)) return false;
+            opts.tournament.rounds = std::max(0, opts.tournament.rounds);
+        }
+        else if (arg == "--games" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.tournament.games)) return false;
+            opts.tournament.games = std::max(1, opts.tournament.games);
+        }
+        else if (arg == "--move-ms" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.tournament.moveMs)) return false;
+            opts.tournament.moveMs = std::max(0, opts.tournament.moveMs);
+        }
+        else if (arg == "--workers" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.tournament.workers)) return false;
+            opts.tournament.workers = std::max(1, opts.tournament.workers);
+        }
+        else if (arg == "--history" && hasValue) {
+            opts.historyPath = argv[++i];
+        }
+        else if (arg == "--no-history") {
+            opts.historyPath.clear();
+        }
+        else if (arg == "--query" && hasValue) {
+            opts.query.name = argv[++i];
+        }
+        else if (arg == "--bench-scoring") {
+            opts.benchScoring = true;
+        }
+        else if (arg == "--bench-undo") {
+            opts.benchUndo = true;
+        }
+        else if (arg == "--check-history") {
+            opts.checkHistory = true;
+        }
+        else if (arg == "--lexicon-stats") {
+            opts.lexiconStats = true;
+        }
+        else if (arg == "--containing" && hasValue) {
+            opts.containing = argv[++i];
+        }
+        else if (arg == "--length" && hasValue) {
+            if (!parseNumber(arg, argv[++i], opts.length)) return false;
+            opts.length = std::max(0, opts.length);
+        }
+        else if (arg == "--min-score" && hasValue) {
+            int minScore = 0;
+            if (!parseNumber(arg, argv[++i], minScore)) return false;
+            opts.query.minScore = static_cast<std::uint32_t>(std::max(0, minScore));
+        }
+        else {
+            std::cerr << "Unknown or incomplete option: " << arg << "\n";
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Command-line tools that run instead of the game window. Returns the exit
+// code, or -1 when no tool was asked for.
+int runTool(const Options& opts)
+{
+    if (!opts.buildLeaves.empty()) {
+        ThreadPool pool(static_cast<int>(std::thread::hardware_concurrency()));
+        unsigned seed = opts.seed ? opts.seed : std::random_device{}();
+        if (!buildLeaveTable(opts.buildLeaves, opts.samples, pool, seed)) return 1;
+
+        LeaveTable table;
+        if (!table.open(opts.buildLeaves)) return 1;
+        benchLeaveTable(table);
+        return 0;
+    }
+    if (opts.benchScoring) {
+        return benchScoring();
+    }
+    if (opts.benchUndo) {
+        return benchUndo();
+    }
+    if (opts.checkHistory) {
+        return checkHistory();
+    }
+    if (opts.lexiconStats) {
+        return lexiconStats(opts.seed);
+    }
+    if (opts.tournamentGiven) {
+        TournamentConfig cfg = opts.tournament;
+        cfg.seed = opts.seed;
+
+        LeaveTable leaves;
+        if (leaves.open(opts.leavesPath)) builtinBotLeaves = &leaves;
+        HistoryWriter history;
+        if (!opts.historyPath.empty()) history.open(opts.historyPath);
+        int rc = runTournament(cfg, history.isOpen() ? &history : nullptr);
+        builtinBotLeaves = nullptr;
+        return rc;
+    }
+    if (!opts.query.name.empty()) {
+        HistoryQuery q = opts.query;
+        q.limit = static_cast<std::size_t>(opts.limit);
+        return queryHistory(opts.historyPath.empty() ? "history.wbh" : opts.historyPath, q);
+    }
+    if (!opts.pattern.empty()) {
+        const Lexicon& lex = lexicon();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<PatternMatch> found =
+            lex.match(opts.pattern, opts.rackGiven ? &opts.rack : nullptr, static_cast<std::size_t>(opts.limit));
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        for (const PatternMatch& m : found) {
+            std::cout << m.word;
+            if (!m.blankLetters.empty()) std::cout << "  blanks: " << m.blankLetters;
+            std::cout << "\n";
+        }
+        std::cout << found.size() << " match(es) in " << us << " us over "
+            << lex.wordCount << " words\n";
+        return 0;
+    }
+    if (!opts.containing.empty()) {
+        std::uint32_t need = 0;
+        for (char c : opts.containing) {
+            int kind = tileIndex(c);
+            if (kind < 0 || kind == BLANK_KIND) {
+                std::cerr << "--containing takes letters only\n";
+                return 2;
+            }
+            need |= 1u << kind;
         }
-        loaded = true;
+        const Lexicon& lex = lexicon();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> found = lex.containing(need, opts.length, static_cast<std::size_t>(opts.limit));
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        for (const std::string& w : found) std::cout << w << "\n";
+        std::cout << found.size() << " word(s) in " << us << " us over "
+            << lex.wordCount << " words\n";
+        return 0;
     }
+    return -1;
+}
 
-    std::string check = word;
-    std::transform(
-        check.begin(), check.end(), check.begin(),
-        [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); }
-    );
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts)) return 2;
 
-    if (words.empty())
-    {
-        return true;
-    }
+    int toolResult = runTool(opts);
+    if (toolResult >= 0) return toolResult;
 
-    if (words.find(check) != words.end())
-    {
-        std::cout << "Valid English word: " << check << "\n";
-        return true;
+    LeaveTable leaves;
+    if (!leaves.open(opts.leavesPath) && opts.leavesPathGiven) {
+        std::cerr << "[WARN] Could not open leave table " << opts.leavesPath
+            << ". Leaves count as zero.\n";
     }
-    else
-    {
-        std::cout << "Not found in dictionary: " << check << "\n";
-        return false;
+    builtinBotLeaves = &leaves;
+
+    BotLibrary seatBots[2];
+    for (int seat = 0; seat < 2; ++seat) {
+        if (!opts.seatBots[seat].empty() && !seatBots[seat].open(opts.seatBots[seat])) return 1;
     }
-}
 
-int main() {
+    HistoryWriter history;
+    if (!opts.historyPath.empty()) history.open(opts.historyPath);
+    std::vector<MoveRecord> gameMoves;
+
     const unsigned int WINDOW_W = 1100;
     const unsigned int WINDOW_H = 640;
 
@@ -347,7 +4422,6 @@ int main() {
         return 1;
     }
 
-    const int   NUM_SPACES = 7;
     const float spaceSize = 72.f;
     const float spacing = 12.f;
 
@@ -366,45 +4440,12 @@ int main() {
     }
 
     std::unordered_map<char, int> scoreMap;
-    scoreMap['A'] = 1;  scoreMap['B'] = 3;  scoreMap['C'] = 3;  scoreMap['D'] = 2;
-    scoreMap['E'] = 1;  scoreMap['F'] = 4;  scoreMap['G'] = 2;  scoreMap['H'] = 4;
-    scoreMap['I'] = 1;  scoreMap['J'] = 8;  scoreMap['K'] = 5;  scoreMap['L'] = 1;
-    scoreMap['M'] = 3;  scoreMap['N'] = 1;  scoreMap['O'] = 1;  scoreMap['P'] = 3;
-    scoreMap['Q'] = 10; scoreMap['R'] = 1;  scoreMap['S'] = 1;  scoreMap['T'] = 1;
-    scoreMap['U'] = 1;  scoreMap['V'] = 4;  scoreMap['W'] = 4;  scoreMap['X'] = 8;
-    scoreMap['Y'] = 4;  scoreMap['Z'] = 10;
-
-    std::vector<char> bag;
-    pushMany(bag, 'E', 12);
-    pushMany(bag, 'A', 9);
-    pushMany(bag, 'I', 9);
-    pushMany(bag, 'O', 8);
-    pushMany(bag, 'N', 6);
-    pushMany(bag, 'R', 6);
-    pushMany(bag, 'T', 6);
-    pushMany(bag, 'L', 4);
-    pushMany(bag, 'S', 4);
-    pushMany(bag, 'U', 4);
-    pushMany(bag, 'D', 4);
-    pushMany(bag, 'G', 3);
-    pushMany(bag, 'B', 2);
-    pushMany(bag, 'C', 2);
-    pushMany(bag, 'M', 2);
-    pushMany(bag, 'P', 2);
-    pushMany(bag, 'F', 2);
-    pushMany(bag, 'H', 2);
-    pushMany(bag, 'V', 2);
-    pushMany(bag, 'W', 2);
-    pushMany(bag, 'Y', 2);
-    pushMany(bag, 'K', 1);
-    pushMany(bag, 'J', 1);
-    pushMany(bag, 'X', 1);
-    pushMany(bag, 'Q', 1);
-    pushMany(bag, 'Z', 1);
+    for (char c = 'A'; c <= 'Z'; ++c) {
+        scoreMap[c] = letterScore(c);
+    }
+    scoreMap[BLANK] = letterScore(BLANK);
 
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::shuffle(bag.begin(), bag.end(), rng);
+    TileBag bag(opts.seed ? opts.seed : std::random_device{}());
 
     std::vector<Tile> racks[2];
     const float tileSize = 64.f;
@@ -416,23 +4457,22 @@ int main() {
     for (char c : p0) {
         char up = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
         int sc = scoreMap[up];
-        racks[0].emplace_back(up, sc, font, tileSize);
+        racks[0].emplace_back(up, sc, tileSize);
     }
     for (char c : p1) {
         char up = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
         int sc = scoreMap[up];
-        racks[1].emplace_back(up, sc, font, tileSize);
+        racks[1].emplace_back(up, sc, tileSize);
     }
 
     auto drawOneFromBag = [&](int playerIdx) {
         if (bag.empty()) return;
-        char c = bag.back();
-        bag.pop_back();
+        char c = bag.draw();
         char up = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
         int sc = 1;
         auto it = scoreMap.find(up);
         if (it != scoreMap.end()) sc = it->second;
-        racks[playerIdx].emplace_back(up, sc, font, tileSize);
+        racks[playerIdx].emplace_back(up, sc, tileSize);
         };
 
     const float rackY_player0 = 340.f;
@@ -534,16 +4574,32 @@ int main() {
 
     int currentPlayer = 0;
     int movesDone = 0;
-    const int MAX_MOVES = 20;
     int totals[2] = { 0, 0 };
 
+    // Z takes back the last drop or move and Y plays it again, as far back
+    // as 1 MiB of edits reaches (thousands of turns).
+    UndoStack<EditAction> edits(1 << 20);
+    RowState grabRow;             // the row before the tile being dragged was picked up
+    bool gameRecorded = false;    // a game goes into the history once, when it first ends
+
+    // Leave one core to the game and render threads so hint rollouts never
+    // starve a frame.
+    ThreadPool rolloutPool(static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    HintEngine hints(rolloutPool);
+    hints.cfg.leaves = &leaves;
+    std::string hintKey;
+    unsigned long long hintRequest = 0;
+    Hint shownHint{};
+    bool hasHint = false;
+
     auto isGameOver = [&]() -> bool {
         return movesDone >= MAX_MOVES;
         };
 
     auto computePlacedScoreForPlayer = [&](int playerIdx) -> int {
-        int letterSum = 0;
-        int wordMult = 1;
+        int letterScores[NUM_SPACES];
+        Mult mults[NUM_SPACES];
+        int count = 0;
 
         for (int i = 0; i < NUM_SPACES; ++i) {
             if (spaces[i].occupantPlayer == playerIdx &&
@@ -551,287 +4607,734 @@ int main() {
             {
                 int idx = spaces[i].occupantIndex;
                 if (idx >= 0 && idx < static_cast<int>(racks[playerIdx].size())) {
-                    int base = racks[playerIdx][idx].score;
-                    switch (spaces[i].mult) {
-                    case Mult::DOUBLE_LETTER: base *= 2; break;
-                    case Mult::TRIPLE_LETTER: base *= 3; break;
-                    case Mult::DOUBLE_WORD:   wordMult *= 2; break;
-                    case Mult::TRIPLE_WORD:   wordMult *= 3; break;
-                    default: break;
-                    }
-                    letterSum += base;
+                    letterScores[count] = racks[playerIdx][idx].score;
+                    mults[count] = spaces[i].mult;
+                    ++count;
                 }
             }
         }
-        return letterSum * wordMult;
+        return scorePlacement(letterScores, mults, count);
         };
 
-    auto commitMove = [&]() {
-        if (isGameOver()) return;
-        std::string formedWord;
+    auto currentPosition = [&]() {
+        Position pos;
+        for (int pl = 0; pl < 2; ++pl) {
+            for (const Tile& t : racks[pl]) pos.racks[pl] += t.letter;
+            pos.totals[pl] = totals[pl];
+        }
+        pos.bag = bag;
+        pos.toMove = currentPlayer;
+        pos.movesDone = movesDone;
+        return pos;
+        };
+
+    auto currentRow = [&]() {
+        RowState row;
         for (int i = 0; i < NUM_SPACES; ++i) {
-            if (spaces[i].occupantPlayer == currentPlayer &&
-                spaces[i].occupantIndex >= 0)
-            {
-                int idx = spaces[i].occupantIndex;
-                if (idx >= 0 && idx < static_cast<int>(racks[currentPlayer].size())) {
-                    char ch = racks[currentPlayer][idx].letter;
-                    char lower = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
-                    formedWord += lower;
-                }
+            if (spaces[i].occupantPlayer == currentPlayer) row.occupant[i] = spaces[i].occupantIndex;
+            row.mult[i] = spaces[i].mult;
+        }
+        row.selectedButton = selectedButton;
+        return row;
+        };
+
+    // Lays `row` out for `player`: tiles onto their spaces, multipliers and
+    // the held button. Tiles left off the row keep their positions; blanks
+    // among them forget the letter they were named.
+    auto restoreRow = [&](const RowState& row, int player) {
+        for (Tile& t : racks[player]) {
+            t.occupantSpace = -1;
+            t.blankAs = 0;
+        }
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            int idx = row.occupant[i];
+            bool placed = idx >= 0 && idx < static_cast<int>(racks[player].size());
+            spaces[i].occupantPlayer = placed ? player : -1;
+            spaces[i].occupantIndex = placed ? idx : -1;
+            spaces[i].mult = row.mult[i];
+            spaces[i].setHighlight(false);
+            spaces[i].applyMultiplierColorOrDefault();
+            if (placed) {
+                Tile& t = racks[player][idx];
+                t.occupantSpace = i;
+                t.setPosition(spaces[i].getCenter() - t.getSize() / 2.f);
             }
         }
+        selectedButton = row.selectedButton;
+        for (std::size_t j = 0; j < buttons.size(); ++j)
+            buttons[j].setPressed(static_cast<int>(j) == selectedButton);
+        };
 
-        if (!formedWord.empty() && !isValidWord(formedWord)) {
-            std::cout << "Move cancelled: invalid word: " << formedWord << "\n";
+    // Plays `a` forwards (first time or redo) or backwards (undo). A commit
+    // played forwards records the tiles it draws; a redo draws the same
+    // ones because the undo put them back on top of the bag.
+    auto applyEdit = [&](EditAction& a, bool forward) {
+        const int pl = a.player;
+        if (a.kind == EditAction::Kind::Drop) {
+            restoreRow(forward ? a.after : a.before, pl);
+            Tile& t = racks[pl][a.tile];
+            if (t.occupantSpace < 0) t.setPosition(a.fromPosition);
             return;
         }
 
-        int moveScore = computePlacedScoreForPlayer(currentPlayer);
-        totals[currentPlayer] += moveScore;
+        TurnDelta& d = a.turn;
+        if (forward) {
+            for (int k = 0; k < d.removedCount; ++k) racks[pl].erase(racks[pl].begin() + d.removedAt[k]);
+            restoreRow(RowState(), pl);
+            d.drawnCount = 0;
+            while (static_cast<int>(racks[pl].size()) < 7 && !bag.empty()) {
+                drawOneFromBag(pl);
+                d.drawn[d.drawnCount++] = racks[pl].back().letter;
+            }
+            totals[pl] += d.score;
+            gameMoves.push_back(a.record);
+            movesDone++;
+            currentPlayer = 1 - pl;
+        }
+        else {
+            for (int k = d.drawnCount - 1; k >= 0; --k) {
+                bag.putBack(racks[pl].back().letter);
+                racks[pl].pop_back();
+            }
+            for (int k = d.removedCount - 1; k >= 0; --k) {
+                char c = d.removed[k];
+                racks[pl].insert(racks[pl].begin() + d.removedAt[k], Tile(c, scoreMap[c], tileSize));
+            }
+            totals[pl] -= d.score;
+            gameMoves.pop_back();
+            movesDone--;
+            currentPlayer = pl;
+        }
+        reflowRack(racks[0], startX, tileSize, rackSpacing, rackY_player0);
+        reflowRack(racks[1], startX, tileSize, rackSpacing, rackY_player1);
+        if (!forward) {
+            // The tiles came back as fresh rack tiles; the blanks on the row
+            // get back the letters the move played them as.
+            restoreRow(a.before, pl);
+            int k = 0;
+            for (int i = 0; i < NUM_SPACES; ++i) {
+                if (spaces[i].occupantPlayer != pl) continue;
+                if (a.record.move.blanks & (1u << k)) racks[pl][spaces[i].occupantIndex].blankAs = a.record.move.word[k];
+                ++k;
+            }
+        }
+
+        if (isGameOver() && !gameRecorded) {
+            history.addGame(gameMoves);
+            history.flush();
+            gameRecorded = true;
+        }
+        };
+
+    // Records `played` as the current player's turn, taking the tiles on
+    // the row off the rack. The row must hold exactly the move's tiles.
+    auto commitPlayed = [&](const Move& played) {
+        EditAction a;
+        a.kind = EditAction::Kind::Commit;
+        a.player = currentPlayer;
+        a.before = currentRow();
+        a.record = { currentPlayer, played, static_cast<int>(bag.size()) };
+        a.turn.player = currentPlayer;
+        a.turn.score = played.score;
 
         std::vector<int> toRemove;
         for (int i = 0; i < NUM_SPACES; ++i) {
             if (spaces[i].occupantPlayer == currentPlayer &&
-                spaces[i].occupantIndex >= 0)
+                spaces[i].occupantIndex >= 0 &&
+                spaces[i].occupantIndex < static_cast<int>(racks[currentPlayer].size()))
             {
                 toRemove.push_back(spaces[i].occupantIndex);
             }
         }
-        if (!toRemove.empty()) {
-            std::sort(toRemove.begin(), toRemove.end(), std::greater<int>());
-            for (int idx : toRemove) {
-                if (idx >= 0 && idx < static_cast<int>(racks[currentPlayer].size())) {
-                    racks[currentPlayer].erase(racks[currentPlayer].begin() + idx);
-                }
-            }
+        std::sort(toRemove.begin(), toRemove.end(), std::greater<int>());
+        for (int idx : toRemove) {
+            a.turn.removed[a.turn.removedCount] = racks[currentPlayer][idx].letter;
+            a.turn.removedAt[a.turn.removedCount++] = static_cast<std::uint8_t>(idx);
         }
 
-        for (Space& sp : spaces) {
-            sp.occupantPlayer = -1;
-            sp.occupantIndex = -1;
-            sp.mult = Mult::NONE;
-            sp.applyMultiplierColorOrDefault();
+        applyEdit(a, true);
+        edits.push(a);
+
+        grabbedIndex = -1;
+        grabbedPlayer = -1;
+        prevOccupiedSpace = -1;
+        };
+
+    auto commitMove = [&]() {
+        if (isGameOver()) return;
+        hints.cancel();
+        hintKey.clear();
+        hasHint = false;
+        // Blanks play as the letters the player named them, and that exact
+        // word is what has to be in the dictionary.
+        Move played = makeMove("");
+        int placed = 0;
+        for (int i = 0; i < NUM_SPACES; ++i) {
+            int idx = spaces[i].occupantIndex;
+            if (spaces[i].occupantPlayer != currentPlayer ||
+                idx < 0 || idx >= static_cast<int>(racks[currentPlayer].size()))
+            {
+                continue;
+            }
+            const Tile& t = racks[currentPlayer][idx];
+            char ch = t.letter;
+            if (ch == BLANK) {
+                if (t.blankAs == 0) {
+                    std::cout << "Move cancelled: name each blank on the row with Shift and a letter\n";
+                    return;
+                }
+                ch = t.blankAs;
+                played.blanks |= 1u << placed;
+            }
+            played.word += ch;
+            played.mults[placed++] = spaces[i].mult;
         }
 
-        while (static_cast<int>(racks[currentPlayer].size()) < 7 && !bag.empty()) {
-            drawOneFromBag(currentPlayer);
+        if (!played.word.empty() && !isValidWord(played.word)) {
+            std::cout << "Move cancelled: invalid word: " << played.label() << "\n";
+            return;
         }
-        reflowRack(racks[0], startX, tileSize, rackSpacing, rackY_player0);
-        reflowRack(racks[1], startX, tileSize, rackSpacing, rackY_player1);
 
-        selectedButton = -1;
-        for (Button& b : buttons) b.setPressed(false);
+        played.score = computePlacedScoreForPlayer(currentPlayer);
+        commitPlayed(played);
+        };
 
-        movesDone++;
-        currentPlayer = 1 - currentPlayer;
+    // Asks the bot in the current seat for a move, lays its tiles on the row
+    // as a player would and commits the move exactly as the bot returned
+    // it. Anything illegal is a pass.
+    std::mt19937 botRng(opts.seed ? opts.seed : std::random_device{}());
+    auto playBotTurn = [&]() {
+        // An undo can leave the previous attempt on the row.
+        restoreRow(RowState(), currentPlayer);
+        reflowRack(racks[currentPlayer], startX, tileSize, rackSpacing,
+            currentPlayer == 0 ? rackY_player0 : rackY_player1);
+
+        const BotLibrary& bot = seatBots[currentPlayer];
+        Position pos = currentPosition();
+        WbGameState state = botState(pos, 0, botRng());
+        WbMove choice{};
+        Move move = makeMove("");
+        if (bot.choose(&state, &choice) == 0 && !readBotMove(choice, pos.racks[currentPlayer], move)) {
+            std::cout << "[WARN] " << bot.name << " tried an illegal move; passing.\n";
+        }
 
-        grabbedIndex = -1;
-        grabbedPlayer = -1;
-        prevOccupiedSpace = -1;
+        std::vector<char> used(racks[currentPlayer].size(), 0);
+        std::string tiles = move.tiles();
+        for (int i = 0; i < static_cast<int>(tiles.size()); ++i) {
+            for (std::size_t t = 0; t < racks[currentPlayer].size(); ++t) {
+                Tile& tile = racks[currentPlayer][t];
+                if (used[t] || tile.letter != tiles[i]) continue;
+                used[t] = 1;
+                if (tile.letter == BLANK) tile.blankAs = move.word[i];
+                tile.setPosition(spaces[i].getCenter() - tile.getSize() / 2.f);
+                tile.occupantSpace = i;
+                spaces[i].occupantPlayer = currentPlayer;
+                spaces[i].occupantIndex = static_cast<int>(t);
+                spaces[i].mult = move.mults[i];
+                spaces[i].applyMultiplierColorOrDefault();
+                break;
+            }
+        }
+        std::cout << bot.name << " plays " << (move.word.empty() ? "a pass" : move.label()) << "\n";
+        hints.cancel();
+        hintKey.clear();
+        hasHint = false;
+        commitPlayed(move);
         };
 
-    sf::Text help(font);
-    help.setCharacterSize(14);
-    help.setFillColor(sf::Color::White);
+    // Input as the render thread forwards it. Runs on the game thread only.
+    auto handleInput = [&](const InputEvent& ev) {
+        if (isGameOver() && ev.kind != InputEvent::Kind::Key)
+            return;
 
-    while (window.isOpen()) {
-        while (const std::optional<sf::Event> event = window.pollEvent()) {
-            if (event->is<sf::Event::Closed>()) {
-                window.close();
-                continue;
-            }
+        // The mouse only moves tiles for a human seat.
+        if (ev.kind != InputEvent::Kind::Key && seatBots[currentPlayer].loaded())
+            return;
 
-            if (isGameOver())
-                continue;
+        if (ev.kind == InputEvent::Kind::Key) {
+            // Shift and a letter names the leftmost blank on the row that
+            // has no letter yet.
+            if (ev.shift && ev.key >= sf::Keyboard::Key::A && ev.key <= sf::Keyboard::Key::Z) {
+                if (seatBots[currentPlayer].loaded()) return;
+                for (int i = 0; i < NUM_SPACES; ++i) {
+                    int idx = spaces[i].occupantIndex;
+                    if (spaces[i].occupantPlayer != currentPlayer ||
+                        idx < 0 || idx >= static_cast<int>(racks[currentPlayer].size()))
+                    {
+                        continue;
+                    }
+                    Tile& t = racks[currentPlayer][idx];
+                    if (t.letter == BLANK && t.blankAs == 0) {
+                        t.blankAs = static_cast<char>('A' +
+                            (static_cast<int>(ev.key) - static_cast<int>(sf::Keyboard::Key::A)));
+                        break;
+                    }
+                }
+                return;
+            }
+            if (ev.key == sf::Keyboard::Key::E) {
+                hints.logNext = true;
+                hintKey.clear();
+            }
+            if ((ev.key == sf::Keyboard::Key::Z || ev.key == sf::Keyboard::Key::Y) && grabbedIndex < 0) {
+                bool undo = ev.key == sf::Keyboard::Key::Z;
+                EditAction* a = undo ? edits.undo() : edits.redo();
+                if (a != nullptr) {
+                    hints.cancel();
+                    hintKey.clear();
+                    hasHint = false;
+                    applyEdit(*a, !undo);
+                }
+            }
+            return;
+        }
 
-            if (const auto* mouseButtonPressed = event->getIf<sf::Event::MouseButtonPressed>()) {
-                sf::Vector2i mpix = mouseButtonPressed->position;
-                sf::Vector2f mp = window.mapPixelToCoords(mpix);
+        if (ev.kind == InputEvent::Kind::Press) {
+            sf::Vector2f mp = ev.position;
 
-                if (mouseButtonPressed->button == sf::Mouse::Button::Right) {
-                    for (int i = 0; i < NUM_SPACES; ++i) {
-                        if (spaces[i].contains(mp)) {
-                            if (spaces[i].mult != Mult::NONE) {
-                                spaces[i].mult = Mult::NONE;
-                                spaces[i].applyMultiplierColorOrDefault();
-                            }
-                            break;
+            if (ev.button == sf::Mouse::Button::Right) {
+                for (int i = 0; i < NUM_SPACES; ++i) {
+                    if (spaces[i].contains(mp)) {
+                        if (spaces[i].mult != Mult::NONE) {
+                            spaces[i].mult = Mult::NONE;
+                            spaces[i].applyMultiplierColorOrDefault();
                         }
+                        break;
                     }
-                    continue;
                 }
-                if (mouseButtonPressed->button == sf::Mouse::Button::Left) {
-                    bool btnHandled = false;
-                    for (std::size_t i = 0; i < buttons.size(); ++i) {
-                        if (buttons[i].contains(mp)) {
-                            selectedButton = static_cast<int>(i);
-                            for (std::size_t j = 0; j < buttons.size(); ++j)
-                                buttons[j].setPressed(static_cast<int>(j) == selectedButton);
-                            btnHandled = true;
-                            break;
-                        }
+                return;
+            }
+            if (ev.button == sf::Mouse::Button::Left) {
+                bool btnHandled = false;
+                for (std::size_t i = 0; i < buttons.size(); ++i) {
+                    if (buttons[i].contains(mp)) {
+                        selectedButton = static_cast<int>(i);
+                        for (std::size_t j = 0; j < buttons.size(); ++j)
+                            buttons[j].setPressed(static_cast<int>(j) == selectedButton);
+                        btnHandled = true;
+                        break;
                     }
-                    if (btnHandled)
-                        continue;
-                    if (commitBtn.contains(mp)) {
-                        bool hasPlaced = false;
-                        for (int i = 0; i < NUM_SPACES; ++i) {
-                            if (spaces[i].occupantPlayer == currentPlayer) {
-                                hasPlaced = true;
-                                break;
-                            }
+                }
+                if (btnHandled)
+                    return;
+                if (commitBtn.contains(mp)) {
+                    bool hasPlaced = false;
+                    for (int i = 0; i < NUM_SPACES; ++i) {
+                        if (spaces[i].occupantPlayer == currentPlayer) {
+                            hasPlaced = true;
+                            break;
                         }
-                        if (hasPlaced)
-                            commitMove();
-                        continue;
                     }
-                    grabbedPlayer = currentPlayer;
-                    grabbedIndex = -1;
-                    for (int i = static_cast<int>(racks[grabbedPlayer].size()) - 1; i >= 0; --i) {
-                        if (racks[grabbedPlayer][i].contains(mp)) {
-                            grabbedIndex = i;
-                            Tile& t = racks[grabbedPlayer][i];
-                            t.grabbed = true;
-                            t.grabOffset = mp - t.getPosition();
-                            t.revertPosition = t.getPosition();
-
-                            prevOccupiedSpace = t.occupantSpace;
-                            if (prevOccupiedSpace != -1 &&
-                                prevOccupiedSpace >= 0 &&
-                                prevOccupiedSpace < static_cast<int>(spaces.size()))
+                    if (hasPlaced)
+                        commitMove();
+                    return;
+                }
+                grabbedPlayer = currentPlayer;
+                grabbedIndex = -1;
+                for (int i = static_cast<int>(racks[grabbedPlayer].size()) - 1; i >= 0; --i) {
+                    if (racks[grabbedPlayer][i].contains(mp)) {
+                        hints.cancel();
+                        hintKey.clear();
+                        hasHint = false;
+                        grabbedIndex = i;
+                        grabRow = currentRow();
+                        Tile& t = racks[grabbedPlayer][i];
+                        t.grabbed = true;
+                        t.blankAs = 0;
+                        t.grabOffset = mp - t.getPosition();
+                        t.revertPosition = t.getPosition();
+
+                        prevOccupiedSpace = t.occupantSpace;
+                        if (prevOccupiedSpace != -1 &&
+                            prevOccupiedSpace >= 0 &&
+                            prevOccupiedSpace < static_cast<int>(spaces.size()))
+                        {
+                            if (spaces[prevOccupiedSpace].occupantPlayer == grabbedPlayer &&
+                                spaces[prevOccupiedSpace].occupantIndex == grabbedIndex)
                             {
-                                if (spaces[prevOccupiedSpace].occupantPlayer == grabbedPlayer &&
-                                    spaces[prevOccupiedSpace].occupantIndex == grabbedIndex)
-                                {
-                                    spaces[prevOccupiedSpace].occupantPlayer = -1;
-                                    spaces[prevOccupiedSpace].occupantIndex = -1;
-                                }
-                                t.occupantSpace = -1;
-                            }
-                            else {
-                                prevOccupiedSpace = -1;
+                                spaces[prevOccupiedSpace].occupantPlayer = -1;
+                                spaces[prevOccupiedSpace].occupantIndex = -1;
                             }
-                            break;
+                            t.occupantSpace = -1;
+                        }
+                        else {
+                            prevOccupiedSpace = -1;
                         }
+                        break;
                     }
                 }
             }
+            return;
+        }
 
-            if (const auto* mouseMoved = event->getIf<sf::Event::MouseMoved>()) {
-                sf::Vector2i mpix = mouseMoved->position;
-                sf::Vector2f mp = window.mapPixelToCoords(mpix);
+        if (ev.kind == InputEvent::Kind::Move) {
+            sf::Vector2f mp = ev.position;
+
+            if (grabbedIndex >= 0 && grabbedPlayer == currentPlayer) {
+                int   highlightIndex = -1;
+                float bestDist = 1e9f;
+
+                for (int i = 0; i < NUM_SPACES; ++i) {
+                    sf::Vector2f c = spaces[i].getCenter();
+                    float dx = mp.x - c.x;
+                    float dy = mp.y - c.y;
+                    float dist = std::sqrt(dx * dx + dy * dy);
+                    if (dist < bestDist && dist < 80.f) {
+                        bestDist = dist;
+                        highlightIndex = i;
+                    }
+                }
 
-                if (grabbedIndex >= 0 && grabbedPlayer == currentPlayer) {
-                    int   highlightIndex = -1;
-                    float bestDist = 1e9f;
+                for (int i = 0; i < NUM_SPACES; ++i) {
+                    if (i == highlightIndex && spaces[i].occupantPlayer == -1)
+                        spaces[i].setHighlight(true);
+                    else
+                        spaces[i].setHighlight(false);
+                }
 
-                    for (int i = 0; i < NUM_SPACES; ++i) {
-                        sf::Vector2f c = spaces[i].getCenter();
-                        float dx = mp.x - c.x;
-                        float dy = mp.y - c.y;
-                        float dist = std::sqrt(dx * dx + dy * dy);
-                        if (dist < bestDist && dist < 80.f) {
-                            bestDist = dist;
-                            highlightIndex = i;
-                        }
+                Tile& t = racks[grabbedPlayer][grabbedIndex];
+                t.setPosition(mp - t.grabOffset);
+            }
+            else {
+                for (auto& sp : spaces)
+                    sp.setHighlight(false);
+            }
+            return;
+        }
+
+        if (ev.kind == InputEvent::Kind::Release) {
+            if (ev.button != sf::Mouse::Button::Left)
+                return;
+
+            if (grabbedIndex >= 0 && grabbedPlayer == currentPlayer) {
+                Tile& t = racks[grabbedPlayer][grabbedIndex];
+                t.grabbed = false;
+
+                sf::Vector2f tileCenter = t.getCenter();
+                int   bestIdx = -1;
+                float bestDist = 1e9f;
+
+                for (int i = 0; i < NUM_SPACES; ++i) {
+                    sf::Vector2f c = spaces[i].getCenter();
+                    float dx = tileCenter.x - c.x;
+                    float dy = tileCenter.y - c.y;
+                    float dist = std::sqrt(dx * dx + dy * dy);
+                    if (dist < bestDist && dist < 50.f) {
+                        bestDist = dist;
+                        bestIdx = i;
                     }
+                }
 
-                    for (int i = 0; i < NUM_SPACES; ++i) {
-                        if (i == highlightIndex && spaces[i].occupantPlayer == -1)
-                            spaces[i].setHighlight(true);
-                        else
-                            spaces[i].setHighlight(false);
+                for (auto& sp : spaces)
+                    sp.setHighlight(false);
+
+                if (bestIdx != -1 && spaces[bestIdx].occupantPlayer == -1) {
+                    sf::Vector2f pos =
+                        spaces[bestIdx].getCenter() - t.getSize() / 2.f;
+                    t.setPosition(pos);
+                    t.occupantSpace = bestIdx;
+
+                    spaces[bestIdx].occupantPlayer = grabbedPlayer;
+                    spaces[bestIdx].occupantIndex = grabbedIndex;
+
+                    if (selectedButton >= 0 &&
+                        selectedButton < static_cast<int>(buttons.size()))
+                    {
+                        Mult m = Mult::NONE;
+                        if (selectedButton == 0)      m = Mult::DOUBLE_LETTER;
+                        else if (selectedButton == 1) m = Mult::TRIPLE_LETTER;
+                        else if (selectedButton == 2) m = Mult::DOUBLE_WORD;
+                        else if (selectedButton == 3) m = Mult::TRIPLE_WORD;
+
+                        spaces[bestIdx].mult = m;
+                        spaces[bestIdx].applyMultiplierColorOrDefault();
+
+                        selectedButton = -1;
+                        for (auto& b : buttons) b.setPressed(false);
                     }
 
-                    Tile& t = racks[grabbedPlayer][grabbedIndex];
-                    t.setPosition(mp - t.grabOffset);
+                    EditAction a;
+                    a.kind = EditAction::Kind::Drop;
+                    a.player = grabbedPlayer;
+                    a.before = grabRow;
+                    a.after = currentRow();
+                    a.tile = grabbedIndex;
+                    a.fromPosition = t.revertPosition;
+                    edits.push(a);
                 }
                 else {
-                    for (auto& sp : spaces)
-                        sp.setHighlight(false);
+                    if (prevOccupiedSpace != -1 &&
+                        spaces[prevOccupiedSpace].occupantPlayer == -1)
+                    {
+                        sf::Vector2f pos =
+                            spaces[prevOccupiedSpace].getCenter() - t.getSize() / 2.f;
+                        t.setPosition(pos);
+                        t.occupantSpace = prevOccupiedSpace;
+
+                        spaces[prevOccupiedSpace].occupantPlayer = grabbedPlayer;
+                        spaces[prevOccupiedSpace].occupantIndex = grabbedIndex;
+                    }
+                    else {
+                        t.setPosition(t.revertPosition);
+                        t.occupantSpace = -1;
+                    }
                 }
+                grabbedIndex = -1;
+                grabbedPlayer = -1;
+                prevOccupiedSpace = -1;
             }
+        }
+        };
 
-            if (const auto* mouseButtonReleased = event->getIf<sf::Event::MouseButtonReleased>()) {
-                if (mouseButtonReleased->button != sf::Mouse::Button::Left)
-                    continue;
+    // Starts a new hint search when the rack or row changed since the last
+    // one, and picks up whatever the search has posted. True when the hint
+    // shown should change.
+    auto updateHint = [&]() -> bool {
+        bool changed = false;
+        if (!isGameOver() && grabbedIndex < 0 && !seatBots[currentPlayer].loaded()) {
+            std::string key = std::to_string(currentPlayer) + ":" + std::to_string(movesDone) + ":";
+            for (const Tile& t : racks[currentPlayer]) key += t.letter;
+            for (const Space& sp : spaces) {
+                key += ':';
+                key += std::to_string(sp.occupantPlayer) + "," + std::to_string(sp.occupantIndex) +
+                    "," + std::to_string(static_cast<int>(sp.mult));
+            }
+            if (key != hintKey) {
+                hintKey = key;
+                hintRequest = hints.request(currentPosition());
+                hasHint = false;
+                changed = true;
+            }
+        }
+        Hint h;
+        while (hints.take(h)) {
+            if (h.request == hintRequest) {
+                shownHint = h;
+                hasHint = true;
+                changed = true;
+            }
+        }
+        return changed;
+        };
+
+    TripleBuffer<FrameSnapshot> frames;
+    InputStamps inputStamps;
+    unsigned long long inputSeq = 0;   // game thread
+
+    auto publishFrame = [&]() {
+        FrameSnapshot& f = frames.back();
+        for (int pl = 0; pl < 2; ++pl) {
+            f.tileCount[pl] = std::min(static_cast<int>(racks[pl].size()), MAX_RACK_TILES);
+            for (int i = 0; i < f.tileCount[pl]; ++i) {
+                const Tile& t = racks[pl][i];
+                char shown = t.blankAs ? static_cast<char>(std::tolower(static_cast<unsigned char>(t.blankAs))) : t.letter;
+                f.tiles[pl][i] = { t.getPosition(), shown, t.score };
+            }
+        }
+        for (int i = 0; i < NUM_SPACES; ++i) f.spaceFill[i] = spaces[i].rect.getFillColor();
+        for (int i = 0; i < MULT_BUTTONS; ++i) f.buttonPressed[i] = buttons[i].pressed;
+
+        f.placedScore = computePlacedScoreForPlayer(currentPlayer);
+        f.totals[0] = totals[0];
+        f.totals[1] = totals[1];
+        f.currentPlayer = currentPlayer;
+        f.movesDone = movesDone;
+        f.bagSize = static_cast<int>(bag.size());
+        f.selectedButton = selectedButton;
+        f.gameOver = isGameOver();
+
+        std::string hint;
+        if (isGameOver()) {
+            hint = "";
+        }
+        else if (seatBots[currentPlayer].loaded()) {
+            hint = "Bot " + seatBots[currentPlayer].name + " to move";
+        }
+        else if (!hasHint) {
+            hint = "Hint: thinking...";
+        }
+        else if (!shownHint.found) {
+            hint = "Hint: no playable word on this rack";
+        }
+        else if (shownHint.rollouts == 0) {
+            hint = "Hint: " + shownHint.move.label() +
+                "  (score " + std::to_string(shownHint.move.score) + ", simulating...)";
+        }
+        else {
+            std::ostringstream hs;
+            hs << std::fixed << std::setprecision(1)
+                << "Hint: " << shownHint.move.label()
+                << "  equity " << shownHint.equity << " +/- " << shownHint.halfWidth
+                << "  (" << shownHint.rollouts << " rollouts"
+                << (shownHint.final ? ")" : ", refining...)");
+            hint = hs.str();
+        }
+        std::size_t n = std::min(hint.size(), sizeof(f.hint) - 1);
+        std::memcpy(f.hint, hint.data(), n);
+        f.hint[n] = '\0';
 
-                if (grabbedIndex >= 0 && grabbedPlayer == currentPlayer) {
-                    Tile& t = racks[grabbedPlayer][grabbedIndex];
-                    t.grabbed = false;
+        f.inputSeq = inputSeq;
 
-                    sf::Vector2f tileCenter = t.getCenter();
-                    int   bestIdx = -1;
-                    float bestDist = 1e9f;
+        frames.publish();
+        };
 
-                    for (int i = 0; i < NUM_SPACES; ++i) {
-                        sf::Vector2f c = spaces[i].getCenter();
-                        float dx = tileCenter.x - c.x;
-                        float dy = tileCenter.y - c.y;
-                        float dist = std::sqrt(dx * dx + dy * dy);
-                        if (dist < bestDist && dist < 50.f) {
-                            bestDist = dist;
-                            bestIdx = i;
-                        }
-                    }
+    // Game logic runs on its own thread so a slow commit, dictionary load or
+    // search never holds up a frame. It sleeps until input arrives, waking
+    // now and then to pick up hints, and publishes a snapshot whenever
+    // something visible changed.
+    SpscQueue<InputEvent, 1024> input;
+    std::mutex inputMtx;
+    std::condition_variable inputReady;
+    std::atomic<bool> running(true);
+
+    auto wakeGame = [&]() {
+        { std::lock_guard<std::mutex> lock(inputMtx); }
+        inputReady.notify_one();
+        };
 
-                    for (auto& sp : spaces)
-                        sp.setHighlight(false);
+    updateHint();
+    publishFrame();
+
+    // Bots wait this long before each move so a watcher can follow the game.
+    const auto botPace = std::chrono::milliseconds(700);
+    auto botDue = std::chrono::steady_clock::now() + botPace;
+
+    std::atomic<long long> movesMerged(0);   // by either thread
+    long long movesPolled = 0;
+
+    // The render thread's own copies of the row and buttons, taken while
+    // this thread is still the only one touching the originals.
+    std::vector<Space> spaceViews = spaces;
+    std::vector<Button> buttonViews = buttons;
+    Button commitView = commitBtn;
+
+    std::thread gameThread([&] {
+        while (running.load()) {
+            bool changed = false;
+            auto apply = [&](const InputEvent& ev) {
+                handleInput(ev);
+                inputStamps.record(++inputSeq, ev.polled);
+                botDue = std::chrono::steady_clock::now() + botPace;
+                changed = true;
+                };
+
+            // A drag only ever shows its latest position, so a run of mouse
+            // moves is applied once, as its last move.
+            InputEvent ev;
+            InputEvent drag{};
+            bool dragging = false;
+            while (input.pop(ev)) {
+                if (ev.kind == InputEvent::Kind::Move) {
+                    if (dragging) {
+                        mergeMove(drag, ev);
+                        ++movesMerged;
+                    }
+                    else {
+                        drag = ev;
+                        dragging = true;
+                    }
+                    continue;
+                }
+                if (dragging) apply(drag);
+                dragging = false;
+                apply(ev);
+            }
+            if (dragging) apply(drag);
+            if (!isGameOver() && seatBots[currentPlayer].loaded() &&
+                std::chrono::steady_clock::now() >= botDue)
+            {
+                playBotTurn();
+                botDue = std::chrono::steady_clock::now() + botPace;
+                changed = true;
+            }
+            if (updateHint()) changed = true;
+            if (changed) publishFrame();
 
-                    if (bestIdx != -1 && spaces[bestIdx].occupantPlayer == -1) {
-                        sf::Vector2f pos =
-                            spaces[bestIdx].getCenter() - t.getSize() / 2.f;
-                        t.setPosition(pos);
-                        t.occupantSpace = bestIdx;
+            std::unique_lock<std::mutex> lock(inputMtx);
+            inputReady.wait_for(lock, std::chrono::milliseconds(5), [&] {
+                return !running.load() || !input.empty();
+            });
+        }
+        });
 
-                        spaces[bestIdx].occupantPlayer = grabbedPlayer;
-                        spaces[bestIdx].occupantIndex = grabbedIndex;
+    // Everything below is the render thread: it owns the window, the font and
+    // every sf::Text, and only ever reads the latest published snapshot.
+    std::vector<TileSprite> tileSprites[2];
+    std::deque<InputEvent> unsent;
+    LatencyHistogram latency;
+    unsigned long long shownInput = 0;   // newest input a displayed frame carried
 
-                        if (selectedButton >= 0 &&
-                            selectedButton < static_cast<int>(buttons.size()))
-                        {
-                            Mult m = Mult::NONE;
-                            if (selectedButton == 0)      m = Mult::DOUBLE_LETTER;
-                            else if (selectedButton == 1) m = Mult::TRIPLE_LETTER;
-                            else if (selectedButton == 2) m = Mult::DOUBLE_WORD;
-                            else if (selectedButton == 3) m = Mult::TRIPLE_WORD;
+    sf::Text help(font);
+    help.setCharacterSize(14);
+    help.setFillColor(sf::Color::White);
 
-                            spaces[bestIdx].mult = m;
-                            spaces[bestIdx].applyMultiplierColorOrDefault();
+    sf::Text hintLabel(font);
+    hintLabel.setCharacterSize(16);
+    hintLabel.setFillColor(sf::Color(255, 240, 160));
+    hintLabel.setPosition(sf::Vector2f(startX, rackY_player1 + tileSize + 24.f));
 
-                            selectedButton = -1;
-                            for (auto& b : buttons) b.setPressed(false);
-                        }
-                    }
-                    else {
-                        if (prevOccupiedSpace != -1 &&
-                            spaces[prevOccupiedSpace].occupantPlayer == -1)
-                        {
-                            sf::Vector2f pos =
-                                spaces[prevOccupiedSpace].getCenter() - t.getSize() / 2.f;
-                            t.setPosition(pos);
-                            t.occupantSpace = prevOccupiedSpace;
+    while (window.isOpen()) {
+        while (const std::optional<sf::Event> event = window.pollEvent()) {
+            if (event->is<sf::Event::Closed>()) {
+                window.close();
+                continue;
+            }
 
-                            spaces[prevOccupiedSpace].occupantPlayer = grabbedPlayer;
-                            spaces[prevOccupiedSpace].occupantIndex = grabbedIndex;
-                        }
-                        else {
-                            t.setPosition(t.revertPosition);
-                            t.occupantSpace = -1;
-                        }
-                    }
-                    grabbedIndex = -1;
-                    grabbedPlayer = -1;
-                    prevOccupiedSpace = -1;
+            InputEvent ev{};
+            ev.polled = std::chrono::steady_clock::now();
+            if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
+                if (keyPressed->code == sf::Keyboard::Key::L && !keyPressed->shift) {
+                    latency.print(std::cout);
+                    continue;
                 }
+                ev.kind = InputEvent::Kind::Key;
+                ev.key = keyPressed->code;
+                ev.shift = keyPressed->shift;
+            }
+            else if (const auto* mouseButtonPressed = event->getIf<sf::Event::MouseButtonPressed>()) {
+                ev.kind = InputEvent::Kind::Press;
+                ev.button = mouseButtonPressed->button;
+                ev.position = window.mapPixelToCoords(mouseButtonPressed->position);
+            }
+            else if (const auto* mouseMoved = event->getIf<sf::Event::MouseMoved>()) {
+                ev.kind = InputEvent::Kind::Move;
+                ev.position = window.mapPixelToCoords(mouseMoved->position);
+            }
+            else if (const auto* mouseButtonReleased = event->getIf<sf::Event::MouseButtonReleased>()) {
+                ev.kind = InputEvent::Kind::Release;
+                ev.button = mouseButtonReleased->button;
+                ev.position = window.mapPixelToCoords(mouseButtonReleased->position);
+            }
+            else {
+                continue;
+            }
+
+            if (ev.kind == InputEvent::Kind::Move) ++movesPolled;
+            if (ev.kind == InputEvent::Kind::Move && !unsent.empty() &&
+                unsent.back().kind == InputEvent::Kind::Move)
+            {
+                mergeMove(unsent.back(), ev);
+                ++movesMerged;
+                continue;
             }
+            unsent.push_back(ev);
+        }
+
+        // If the game thread has fallen behind and the queue is full, the
+        // rest waits for the next frame rather than stalling this one.
+        bool sent = false;
+        while (!unsent.empty() && input.push(unsent.front())) {
+            unsent.pop_front();
+            sent = true;
         }
-        int currentPlacedScore = computePlacedScoreForPlayer(currentPlayer);
+        if (sent) wakeGame();
+
+        bool fresh = frames.acquire();
+        const FrameSnapshot& frame = frames.front();
 
         const float maxVisualScore = 50.f;
         float fillRatio = clampFloat(
-            static_cast<float>(currentPlacedScore) / maxVisualScore,
+            static_cast<float>(frame.placedScore) / maxVisualScore,
             0.f, 1.f
         );
 
@@ -841,7 +5344,7 @@ int main() {
         barFill.setPosition(bgPos);
         barFill.setSize(sf::Vector2f(bgSize.x * fillRatio, barHeight));
 
-        scoreLabel.setString("Score (this move): " + std::to_string(currentPlacedScore));
+        scoreLabel.setString("Score (this move): " + std::to_string(frame.placedScore));
         {
             sf::FloatRect sb = scoreLabel.getLocalBounds();
             scoreLabel.setPosition(
@@ -852,36 +5355,41 @@ int main() {
             );
         }
 
-        totalLabelP0.setString("P1 Total: " + std::to_string(totals[0]));
+        totalLabelP0.setString("P1 Total: " + std::to_string(frame.totals[0]));
         totalLabelP0.setPosition(bgPos + sf::Vector2f(12.f, -28.f));
 
-        totalLabelP1.setString("P2 Total: " + std::to_string(totals[1]));
+        totalLabelP1.setString("P2 Total: " + std::to_string(frame.totals[1]));
         totalLabelP1.setPosition(bgPos + sf::Vector2f(bgSize.x - 140.f, -28.f));
 
-        turnLabel.setString("Turn: Player " + std::to_string(currentPlayer + 1));
+        turnLabel.setString("Turn: Player " + std::to_string(frame.currentPlayer + 1));
         turnLabel.setPosition(bgPos + sf::Vector2f(bgSize.x / 2.f - 60.f, -28.f));
 
         movesLabel.setString(
-            "Moves: " + std::to_string(movesDone) + " / " + std::to_string(MAX_MOVES)
+            "Moves: " + std::to_string(frame.movesDone) + " / " + std::to_string(MAX_MOVES)
         );
         movesLabel.setPosition(
             bgPos + sf::Vector2f(bgSize.x - 200.f, (barHeight - 20.f) / 2.f)
         );
 
-        bagCountText.setString("Tiles left: " + std::to_string(static_cast<int>(bag.size())));
+        bagCountText.setString("Tiles left: " + std::to_string(frame.bagSize));
         bagCountText.setPosition(bgPos + sf::Vector2f(bgSize.x - 200.f, -5.f));
 
-        std::string selText = (selectedButton == -1)
+        std::string selText = (frame.selectedButton == -1)
             ? "None"
-            : ("#" + std::to_string(selectedButton + 1));
+            : ("#" + std::to_string(frame.selectedButton + 1));
 
         help.setString(
-            "Player " + std::to_string(currentPlayer + 1) +
-            " turn. Left-click multiplier then drop tile. Right-click space to remove multiplier. Selected: " +
+            "Player " + std::to_string(frame.currentPlayer + 1) +
+            " turn. Left-click multiplier then drop tile. Right-click space to remove multiplier. E: move equities. L: input latency. Z/Y: undo/redo. Shift+letter: name a blank. Selected: " +
             selText
         );
         help.setPosition(sf::Vector2f(10.f, static_cast<float>(WINDOW_H) - 26.f));
 
+        hintLabel.setString(frame.hint);
+
+        for (int i = 0; i < NUM_SPACES; ++i) spaceViews[i].rect.setFillColor(frame.spaceFill[i]);
+        for (int i = 0; i < MULT_BUTTONS; ++i) buttonViews[i].setPressed(frame.buttonPressed[i]);
+
         window.clear(sf::Color(30, 100, 40));
 
         window.draw(barBg);
@@ -894,20 +5402,28 @@ int main() {
         window.draw(movesLabel);
         window.draw(bagCountText);
 
-        for (const Space& sp : spaces) sp.draw(window);
-        for (const Tile& t : racks[0]) t.draw(window);
-        for (const Tile& t : racks[1]) t.draw(window); 
+        for (const Space& sp : spaceViews) sp.draw(window);
+        for (int pl = 0; pl < 2; ++pl) {
+            while (static_cast<int>(tileSprites[pl].size()) < frame.tileCount[pl]) {
+                tileSprites[pl].emplace_back(font, tileSize);
+            }
+            for (int i = 0; i < frame.tileCount[pl]; ++i) {
+                tileSprites[pl][i].show(frame.tiles[pl][i]);
+                tileSprites[pl][i].draw(window);
+            }
+        }
 
-        for (const Button& b : buttons) b.draw(window, font);
-        commitBtn.draw(window, font);
+        for (const Button& b : buttonViews) b.draw(window, font);
+        commitView.draw(window, font);
 
         window.draw(help);
+        window.draw(hintLabel);
 
-        if (isGameOver()) {
+        if (frame.gameOver) {
             std::string result;
-            if (totals[0] > totals[1])      result = "Game over. Player 1 wins!";
-            else if (totals[1] > totals[0]) result = "Game over. Player 2 wins!";
-            else                             result = "Game over. It's a tie!";
+            if (frame.totals[0] > frame.totals[1])      result = "Game over. Player 1 wins!";
+            else if (frame.totals[1] > frame.totals[0]) result = "Game over. Player 2 wins!";
+            else                                         result = "Game over. It's a tie!";
 
             sf::RectangleShape overlay;
             overlay.setSize(sf::Vector2f(static_cast<float>(WINDOW_W) - 200.f, 140.f));
@@ -926,8 +5442,8 @@ int main() {
             finalScore.setCharacterSize(20);
             finalScore.setFillColor(sf::Color::White);
             finalScore.setString(
-                "Final - P1: " + std::to_string(totals[0]) +
-                "   P2: " + std::to_string(totals[1])
+                "Final - P1: " + std::to_string(frame.totals[0]) +
+                "   P2: " + std::to_string(frame.totals[1])
             );
             finalScore.setPosition(overlay.getPosition() + sf::Vector2f(20.f, 60.f));
 
@@ -937,6 +5453,19 @@ int main() {
         }
 
         window.display();
+        if (fresh && frame.inputSeq > shownInput) {
+            latency.add(std::chrono::steady_clock::now() - inputStamps.oldestAfter(shownInput, frame.inputSeq));
+            shownInput = frame.inputSeq;
+        }
+    }
+
+    running = false;
+    wakeGame();
+    gameThread.join();
+
+    if (latency.n > 0) {
+        latency.print(std::cout);
+        std::cout << movesMerged << " of " << movesPolled << " mouse moves merged into a later one\n";
     }
 
     return 0;